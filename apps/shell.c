@@ -1,21 +1,147 @@
 #include "../drivers/display.h"
 #include "../kernel/util.h"
+#include "../kernel/arena.h"
+#include "../kernel/boottime.h"
+#include "../kernel/thread.h"
+#include "../kernel/channel.h"
+#include "../kernel/ksyms.h"
+#include "../cpu/syscall.h"
+#include "../cpu/idle.h"
+#include "../cpu/isr.h"
+#include "../kernel/elf.h"
+#include "../kernel/mem.h"
+#include "../drivers/block.h"
+#include "../drivers/pci.h"
+#include "../drivers/virtio_blk.h"
 #include "shell.h"
 
+#define SHELL_ARENA_SIZE (8 * 1024)
+
+/* One shell thread per console */
+typedef struct {
+    channel_t input; /* lines from the keyboard IRQ, one page buffer each */
+    /* Scratch memory for the command being executed.
+     * Reset after every command, so nothing allocated here outlives it. */
+    uint8_t arena_area[SHELL_ARENA_SIZE] __attribute__((aligned(ARENA_ALIGNMENT)));
+    arena_t arena;
+} shell_t;
+
+static shell_t shells[NUM_CONSOLES];
+
+static arena_t *shell_arena() {
+    return &shells[current_thread()->console].arena;
+}
+
+void *shell_alloc(size_t size) {
+    return arena_alloc(shell_arena(), size);
+}
+
+bool shell_submit_line(int console, char *line) {
+    message_t message = {line, string_length(line) + 1};
+    return channel_try_send(&shells[console].input, message);
+}
+
+/* Sleeps until the keyboard hands over a line, no cycles spent waiting */
+static void shell_thread(void *data) {
+    shell_t *shell = data;
+    message_t message;
+    while (channel_receive(&shell->input, &message)) {
+        execute_command(message.data);
+        page_buffer_free(message.data);
+    }
+}
+
+void start_shells() {
+    for (int console = 0; console < NUM_CONSOLES; console++) {
+        shell_t *shell = &shells[console];
+        arena_init(&shell->arena, shell->arena_area, SHELL_ARENA_SIZE);
+        thread_create("shell", shell_thread, shell, console);
+    }
+}
+
+static void run_program(char *name) {
+    program_image_t *program = find_program(name);
+    if (program == NULL_POINTER) {
+        print_string("No such program: ");
+        print_string(name);
+        return;
+    }
+
+    char exit_code[12];
+    int_to_string(elf_run(program), exit_code);
+    print_string("Exited with ");
+    print_string(exit_code);
+}
+
 void execute_command(char *input) {
     if (compare_string(input, "EXIT") == 0) {
         print_string("Stopping The CPU. Farewell! :3\n");
-        asm volatile("hlt");
+        asm volatile("cli; hlt");
     }
 
     else if (compare_string(input, "CLS") == 0) {
         clear_screen();
     }
 
+    else if (compare_string(input, "BOOTTIME") == 0) {
+        print_boot_log();
+    }
+
+    else if (compare_string(input, "SYSBENCH") == 0) {
+        run_syscall_benchmark();
+    }
+
+    else if (compare_string(input, "BACKTRACE") == 0) {
+        print_backtrace((uint32_t) __builtin_frame_address(0));
+    }
+
+    else if (compare_string(input, "IRQSTAT") == 0) {
+        print_interrupt_stats();
+    }
+
+    else if (compare_string(input, "MEM") == 0) {
+        print_dynamic_mem();
+    }
+
+    else if (compare_string(input, "UPTIME") == 0) {
+        print_load();
+    }
+
+    else if (compare_string(input, "DISK") == 0) {
+        for (int i = 0; block_get_device(i) != NULL_POINTER; i++) {
+            /* Each device gets the same scratch buffer back */
+            arena_mark_t mark = arena_mark(shell_arena());
+            uint8_t *buffer = shell_alloc(BLOCK_TEST_BYTES);
+            if (buffer == NULL_POINTER) {
+                print_string("Not enough scratch memory for the disk test.\n");
+                break;
+            }
+            print_string(block_get_device(i)->name);
+            print_string(": ");
+            run_block_test(block_get_device(i), buffer);
+            arena_reset(shell_arena(), mark);
+        }
+        print_block_stats();
+        print_virtio_blk_stats();
+    }
+
+    else if (compare_string(input, "CHANBENCH") == 0) {
+        run_channel_benchmark();
+    }
+
+    else if (compare_string(input, "LSPCI") == 0) {
+        print_pci_devices();
+    }
+
+    else if (string_starts_with(input, "RUN ")) {
+        run_program(input + 4);
+    }
+
     else {
         print_string("Unknown command: ");
         print_string(input);
     }
 
+    arena_reset(shell_arena(), 0);
     print_string("\n> ");
-}
\ No newline at end of file
+}
@@ -1 +1,17 @@
-void execute_command(char *input);
\ No newline at end of file
+#pragma once
+
+#include <stddef.h>
+#include <stdbool.h>
+
+void execute_command(char *input);
+
+/* Start a shell thread on every console */
+void start_shells();
+
+/* Hand a finished input line, a page buffer, to the shell of 'console'
+ * from the keyboard IRQ. The shell owns and frees it from then on. Returns
+ * false if the shell has too many lines queued, the caller keeps the line. */
+bool shell_submit_line(int console, char *line);
+
+/* Scratch memory of the calling shell, freed after the current command */
+void *shell_alloc(size_t size);
@@ -0,0 +1,20 @@
+; Boot-phase timestamps handed over to the kernel.
+; The layout must match boot_log_t in kernel/boottime.h.
+BOOT_LOG_ADDRESS equ 0x600 ; Free low memory, below where the kernel is loaded
+BOOT_LOG_MAGIC equ 0x544F4F42 ; "BOOT", written by the MBR
+BOOT_LOG_TSC equ BOOT_LOG_ADDRESS + 8
+
+; Stage indices, same order as boot_stage_t
+BOOT_MBR_ENTRY equ 0
+BOOT_DISK_LOAD_BEGIN equ 1
+BOOT_DISK_LOAD_END equ 2
+BOOT_PROTECTED_MODE equ 3
+BOOT_DECOMPRESS_END equ 4
+BOOT_KERNEL_ENTRY equ 5
+
+; Record the time stamp counter for a stage. Clobbers eax and edx.
+%macro BOOT_STAMP 1
+    rdtsc
+    mov [BOOT_LOG_TSC + %1 * 8], eax
+    mov [BOOT_LOG_TSC + %1 * 8 + 4], edx
+%endmacro
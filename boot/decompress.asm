@@ -0,0 +1,84 @@
+; Decompression stage. mbr.asm loads this stub together with the LZ4
+; compressed kernel that follows it, and jumps here in protected mode.
+; We expand the kernel to its link address and jump to kernel_entry.
+[org 0x50000] ; STAGE_ADDRESS in mbr.asm
+[bits 32]
+
+KERNEL_OFFSET equ 0x1000 ; The same one we used when linking the kernel
+LZ4_LEGACY_MAGIC equ 0x184C2102
+
+%include "boot/boot_log.asm"
+
+; The payload is a file in LZ4's legacy format (lz4 -l): the magic, then
+; blocks each prefixed with their compressed size. The makefile appends a
+; zero size to mark the end.
+decompress:
+    cld
+    mov esi, payload
+    mov edi, KERNEL_OFFSET
+    cmp dword [esi], LZ4_LEGACY_MAGIC
+    jne bad_payload
+    add esi, 4
+
+next_block:
+    lodsd
+    test eax, eax
+    jz decompress_done
+    cmp eax, LZ4_LEGACY_MAGIC ; concatenated files start over with the magic
+    je next_block
+    lea ebx, [esi + eax] ; end of this block
+
+; A sequence is a token (literal length << 4 | match length - 4), the
+; literals, then the match as a 16-bit offset back into the output
+next_sequence:
+    movzx edx, byte [esi]
+    inc esi
+    mov eax, edx
+    shr eax, 4
+    call read_length
+    mov ecx, eax
+    rep movsb ; literals
+    cmp esi, ebx
+    jae next_block ; the last sequence of a block has no match
+
+    movzx ebp, word [esi] ; match offset
+    add esi, 2
+    mov eax, edx
+    and eax, 0x0F
+    call read_length
+    lea ecx, [eax + 4] ; matches are at least 4 bytes
+    push esi
+    mov esi, edi
+    sub esi, ebp
+    rep movsb ; byte by byte, so a match may overlap what it produces
+    pop esi
+    jmp next_sequence
+
+; Lengths of 15 continue in the following bytes, each adding up to 255
+read_length:
+    cmp eax, 15
+    jne read_length_done
+read_length_more:
+    movzx ecx, byte [esi]
+    inc esi
+    add eax, ecx
+    cmp ecx, 255
+    je read_length_more
+read_length_done:
+    ret
+
+decompress_done:
+    BOOT_STAMP BOOT_DECOMPRESS_END
+    xor eax, eax ; not the Multiboot magic, so kernel_entry knows who called
+    jmp KERNEL_OFFSET
+
+bad_payload:
+    mov ebx, MSG_BAD_PAYLOAD
+    call print32
+    jmp $
+
+%include "boot/print_32bit.asm"
+
+MSG_BAD_PAYLOAD db "Bad kernel payload", 0
+
+payload: ; the compressed kernel is appended here by the makefile
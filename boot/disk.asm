@@ -1,46 +1,70 @@
-; load 'dh' sectors from drive 'dl' into ES:BX
+; load 'si' sectors following the boot sector from drive 'dl' into es:0
+; A track at a time: one BIOS call per track instead of one per sector,
+; and no call crosses a track, which not every BIOS handles. Nor does one
+; cross a 64 KiB boundary, floppy DMA can't (int 0x13 error 9), so such a
+; track is read in two calls.
+SECTORS_PER_TRACK equ 18 ; 1.44 MB floppy
 disk_load:
     pusha
-    ; reading from disk requires setting specific values in all registers
-    ; so we will overwrite our input parameters from 'dx'. Let's save it
-    ; to the stack for later use.
-    push dx
-
-    mov ah, 0x02 ; ah <- int 0x13 function. 0x02 = 'read'
-    mov al, dh   ; al <- number of sectors to read (0x01 .. 0x80)
-    mov cl, 0x02 ; cl <- sector (0x01 .. 0x11)
-                 ; 0x01 is our boot sector, 0x02 is the first 'available' sector
-    mov ch, 0x00 ; ch <- cylinder (0x0 .. 0x3FF, upper 2 bits in 'cl')
-    ; dl <- drive number. Our caller sets it as a parameter and gets it from BIOS
-    ; (0 = floppy, 1 = floppy2, 0x80 = hdd, 0x81 = hdd2)
-    mov dh, 0x00 ; dh <- head number (0x0 .. 0xF)
-
-    ; [es:bx] <- pointer to buffer where the data will be stored
-    ; caller sets it up for us, and it is actually the standard location for int 13h
+    mov cx, 0x0002 ; ch <- cylinder 0, cl <- sector 2 (sector 1 is our boot sector)
+    mov dh, 0x00   ; dh <- head number
+
+disk_load_track:
+    ; al <- sectors left on this track, or left to read if that is fewer
+    mov al, SECTORS_PER_TRACK + 1
+    sub al, cl
+    xor ah, ah
+    cmp ax, si
+    jbe disk_load_boundary
+    mov ax, si
+
+disk_load_boundary:
+    ; bx <- sectors up to the next 64 KiB boundary, es is sector aligned
+    mov bx, es
+    and bx, 0x0FFF
+    neg bx
+    add bx, 0x1000
+    shr bx, 5
+    cmp ax, bx
+    jbe disk_load_read
+    mov ax, bx
+
+disk_load_read:
+    push ax
+    mov ah, 0x02  ; ah <- int 0x13 function. 0x02 = 'read'
+    mov bx, 0     ; [es:bx] <- buffer
     int 0x13      ; BIOS interrupt
     jc disk_error ; if error (stored in the carry bit)
+    pop ax
+
+    ; continue on this track after what was read
+    sub si, ax
+    add cl, al
+
+    ; move the buffer on by al * 512 bytes, i.e. al * 32 paragraphs
+    shl ax, 5
+    mov bx, es
+    add bx, ax
+    mov es, bx
 
-    pop dx
-    cmp al, dh    ; BIOS also sets 'al' to the # of sectors read. Compare it.
-    jne sectors_error
+    ; past the last sector the next track starts at sector 1, on the other
+    ; head or the next cylinder
+    cmp cl, SECTORS_PER_TRACK
+    jbe disk_load_next
+    mov cl, 1
+    xor dh, 1
+    jnz disk_load_next
+    inc ch
+
+disk_load_next:
+    test si, si
+    jnz disk_load_track
     popa
     ret
 
-
 disk_error:
     mov bx, DISK_ERROR
     call print16
-    call print16_nl
-    mov dh, ah ; ah = error code, dl = disk drive that dropped the error
-    call print16_hex ; check out the code at http://stanislavs.org/helppc/int_13-1.html
-    jmp disk_loop
-
-sectors_error:
-    mov bx, SECTORS_ERROR
-    call print16
-
-disk_loop:
     jmp $
 
 DISK_ERROR: db "Disk read error", 0
-SECTORS_ERROR: db "Incorrect number of sectors read", 0
\ No newline at end of file
@@ -1,7 +1,69 @@
 global _start;
 [bits 32]
 
+; Multiboot header, so that a Multiboot loader (e.g. qemu -kernel) can load
+; the ELF directly. It must be 32-bit aligned within the first 8 KiB.
+MULTIBOOT_MAGIC equ 0x1BADB002
+MULTIBOOT_FLAGS equ 0x3 ; page-align modules, provide memory information
+MULTIBOOT_CHECKSUM equ -(MULTIBOOT_MAGIC + MULTIBOOT_FLAGS)
+MULTIBOOT_BOOTLOADER_MAGIC equ 0x2BADB002 ; what the loader leaves in 'eax'
+
+%include "boot/boot_log.asm"
+
+section .text
 _start:
+    jmp multiboot_entry ; The MBR jumps straight to 0x1000, so skip the header
+
+align 4
+multiboot_header:
+    dd MULTIBOOT_MAGIC
+    dd MULTIBOOT_FLAGS
+    dd MULTIBOOT_CHECKSUM
+
+multiboot_entry:
+    cmp eax, MULTIBOOT_BOOTLOADER_MAGIC
+    jne load_gdt ; Booted through mbr.asm and decompress.asm
+    mov [multiboot_info], ebx
+    mov dword [BOOT_LOG_ADDRESS], 0 ; No MBR ran, whatever is in its stamps is stale
+
+load_gdt:
+    ; Either a Multiboot loader's GDT is loaded, or the MBR's, which the
+    ; decompressed kernel has overwritten. Load ours and set up the same
+    ; segments and stack as switch_to_32bit.
+    lgdt [gdt_descriptor]
+    jmp CODE_SEG:reload_segments
+
+reload_segments:
+    mov ax, DATA_SEG
+    mov ds, ax
+    mov ss, ax
+    mov es, ax
+    mov fs, ax
+    mov gs, ax
+
+    mov ebp, 0x90000
+    mov esp, ebp
+
+    ; Only the file contents were loaded (or decompressed), clear .bss
+    [extern __bss_start]
+    [extern __bss_end]
+    mov edi, __bss_start
+    mov ecx, __bss_end
+    sub ecx, edi
+    xor eax, eax
+    cld
+    rep stosb
+
+start_kernel:
+    BOOT_STAMP BOOT_KERNEL_ENTRY
+    xor ebp, ebp ; End of the frame pointer chain for backtraces
     [extern main] ; Define calling point. Must have same name as kernel.c 'main' function
     call main ; Calls the C function. The linker will know where it is placed in memory
-    jmp $
\ No newline at end of file
+    [extern cpu_idle]
+    call cpu_idle ; Everything else happens in interrupts, halt in between. Doesn't return
+
+%include "boot/gdt.asm"
+
+section .data
+global multiboot_info
+multiboot_info: dd 0 ; Physical address of the Multiboot information, 0 when booted from the MBR
@@ -1,7 +1,15 @@
 [org 0x7c00]
-KERNEL_OFFSET equ 0x1000 ; The same one we used when linking the kernel
+; The compressed kernel and the stub that expands it to 0x1000 (see
+; decompress.asm) are loaded out of its way. The makefile passes their
+; size with -DKERNEL_SECTORS.
+STAGE_SEGMENT equ 0x5000
+STAGE_ADDRESS equ STAGE_SEGMENT * 16 ; the makefile checks the kernel and stage sizes against it
+
+%include "boot/boot_log.asm"
 
 mov [BOOT_DRIVE], dl ; Remember that the BIOS sets us the boot drive in 'dl' on boot
+mov dword [BOOT_LOG_ADDRESS], BOOT_LOG_MAGIC
+BOOT_STAMP BOOT_MBR_ENTRY
 mov bp, 0x9000
 mov sp, bp
 
@@ -25,17 +33,21 @@ load_kernel:
     call print16
     call print16_nl
 
-    mov bx, KERNEL_OFFSET ; Read from disk and store in 0x1000
-    mov dh, 31
+    mov ax, STAGE_SEGMENT
+    mov es, ax
+    BOOT_STAMP BOOT_DISK_LOAD_BEGIN ; before 'dx' is set, the stamp clobbers it
+    mov si, KERNEL_SECTORS
     mov dl, [BOOT_DRIVE]
     call disk_load
+    BOOT_STAMP BOOT_DISK_LOAD_END
     ret
 
 [bits 32]
 BEGIN_32BIT:
+    BOOT_STAMP BOOT_PROTECTED_MODE
     mov ebx, MSG_32BIT_MODE
     call print32
-    call KERNEL_OFFSET ; Give control to the kernel
+    call STAGE_ADDRESS ; Decompress the kernel and give control to it
     jmp $ ; Stay here when the kernel returns control to us (if ever)
 
 
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <stdint.h>
+
+/* Feature bits reported by CPUID leaf 1 in EDX */
+#define CPUID_EDX_TSC  (1 << 4)
+#define CPUID_EDX_SEP  (1 << 11)
+#define CPUID_EDX_FXSR (1 << 24)
+#define CPUID_EDX_SSE  (1 << 25)
+
+static inline void cpuid(uint32_t leaf, uint32_t *eax, uint32_t *ebx, uint32_t *ecx, uint32_t *edx) {
+    asm volatile("cpuid" : "=a" (*eax), "=b" (*ebx), "=c" (*ecx), "=d" (*edx) : "a" (leaf), "c" (0));
+}
+
+static inline uint32_t cpuid_features_edx() {
+    uint32_t eax, ebx, ecx, edx;
+    cpuid(1, &eax, &ebx, &ecx, &edx);
+    return edx;
+}
@@ -0,0 +1,84 @@
+#include "fpu.h"
+#include "cpuid.h"
+#include "isr.h"
+
+#define CR0_MP (1 << 1)
+#define CR0_EM (1 << 2)
+#define CR0_TS (1 << 3)
+#define CR4_OSFXSR (1 << 9)
+#define CR4_OSXMMEXCPT (1 << 10)
+
+#define MXCSR_DEFAULT 0x1F80 /* all SSE exceptions masked */
+
+static fpu_context_t kernel_fpu_context; /* state of the boot thread */
+static fpu_context_t *fpu_current = &kernel_fpu_context; /* whose state the CPU should have */
+static fpu_context_t *fpu_owner; /* whose state the CPU actually has */
+static bool sse_enabled = false;
+
+static inline void set_ts() {
+    uint32_t cr0;
+    asm volatile("mov %%cr0, %0" : "=r" (cr0));
+    asm volatile("mov %0, %%cr0" : : "r" (cr0 | CR0_TS));
+}
+
+/* #NM: someone touched the FPU while CR0.TS was set */
+static bool device_not_available_handler(registers_t *regs) {
+    asm volatile("clts");
+    if (fpu_owner == fpu_current) {
+        return IRQ_HANDLED;
+    }
+
+    if (fpu_owner != 0) {
+        asm volatile("fxsave (%0)" : : "r" (fpu_owner->fxsave_area) : "memory");
+    }
+
+    if (fpu_current->initialized) {
+        asm volatile("fxrstor (%0)" : : "r" (fpu_current->fxsave_area) : "memory");
+    } else {
+        uint32_t mxcsr = MXCSR_DEFAULT;
+        asm volatile("fninit");
+        asm volatile("ldmxcsr %0" : : "m" (mxcsr));
+        fpu_current->initialized = true;
+    }
+    fpu_owner = fpu_current;
+    return IRQ_HANDLED;
+}
+
+void init_fpu() {
+    uint32_t features = cpuid_features_edx();
+    if (!(features & CPUID_EDX_FXSR) || !(features & CPUID_EDX_SSE)) {
+        return;
+    }
+
+    uint32_t cr0, cr4;
+    asm volatile("mov %%cr0, %0" : "=r" (cr0));
+    cr0 &= ~CR0_EM;
+    cr0 |= CR0_MP;
+    asm volatile("mov %0, %%cr0" : : "r" (cr0));
+
+    asm volatile("mov %%cr4, %0" : "=r" (cr4));
+    cr4 |= CR4_OSFXSR | CR4_OSXMMEXCPT;
+    asm volatile("mov %0, %%cr4" : : "r" (cr4));
+
+    register_interrupt_handler(7, device_not_available_handler);
+    sse_enabled = true;
+
+    /* Nobody owns the FPU yet, so the first use has to trap */
+    set_ts();
+}
+
+void fpu_switch_to(fpu_context_t *context) {
+    fpu_current = context;
+    if (!sse_enabled) {
+        return;
+    }
+    if (fpu_owner == context) {
+        asm volatile("clts");
+    } else {
+        set_ts();
+    }
+}
+
+bool fpu_sse_enabled() {
+    return sse_enabled;
+}
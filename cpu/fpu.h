@@ -0,0 +1,19 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* x87/MMX/SSE register state as laid out by FXSAVE */
+typedef struct {
+    uint8_t fxsave_area[512];
+    bool initialized; /* false until the owner executes its first FPU/SSE instruction */
+} __attribute__((aligned(16))) fpu_context_t;
+
+void init_fpu();
+
+/* Make 'context' the state of whatever runs next.
+ * Nothing is saved or restored here: CR0.TS is set and the first FPU/SSE
+ * instruction traps into #NM, which swaps the register state in. */
+void fpu_switch_to(fpu_context_t *context);
+
+bool fpu_sse_enabled();
@@ -0,0 +1,55 @@
+#include "gdt.h"
+#include "percpu.h"
+
+gdt_entry_t gdt[GDT_ENTRIES];
+gdt_register_t gdt_reg;
+tss_t tss;
+
+static void set_gdt_entry(int n, uint32_t base, uint32_t limit, uint8_t access, uint8_t flags) {
+    gdt[n].limit_low = limit & 0xFFFF;
+    gdt[n].base_low = base & 0xFFFF;
+    gdt[n].base_middle = (base >> 16) & 0xFF;
+    gdt[n].access = access;
+    gdt[n].granularity = (flags & 0xF0) | ((limit >> 16) & 0x0F);
+    gdt[n].base_high = (base >> 24) & 0xFF;
+}
+
+/* Replaces the boot GDT from boot/gdt.asm, which only has kernel segments */
+void gdt_install() {
+    set_gdt_entry(0, 0, 0, 0, 0);
+    /* Flat 4 GiB segments, 4 KiB granularity, 32 bit */
+    set_gdt_entry(1, 0, 0xFFFFF, 0x9A, 0xC0); /* kernel code */
+    set_gdt_entry(2, 0, 0xFFFFF, 0x92, 0xC0); /* kernel data */
+    set_gdt_entry(3, 0, 0xFFFFF, 0xFA, 0xC0); /* user code */
+    set_gdt_entry(4, 0, 0xFFFFF, 0xF2, 0xC0); /* user data */
+
+    tss.ss0 = KERNEL_DS;
+    tss.iomap_base = sizeof(tss_t); /* no I/O permission bitmap */
+    set_gdt_entry(5, (uint32_t) &tss, sizeof(tss_t) - 1, 0x89, 0x00);
+
+    /* Byte granular, just the block itself */
+    set_gdt_entry(6, (uint32_t) boot_percpu(), sizeof(percpu_t) - 1, 0x92, 0x40);
+
+    gdt_reg.base = (uint32_t) &gdt;
+    gdt_reg.limit = GDT_ENTRIES * sizeof(gdt_entry_t) - 1;
+    asm volatile("lgdt (%0)" : : "r" (&gdt_reg));
+
+    /* Reload every segment register so nothing refers to the old table */
+    asm volatile(
+            "ljmp %0, $1f\n"
+            "1:\n"
+            "mov %1, %%ax\n"
+            "mov %%ax, %%ds\n"
+            "mov %%ax, %%es\n"
+            "mov %%ax, %%fs\n"
+            "mov %%ax, %%ss\n"
+            "mov %2, %%ax\n"
+            "mov %%ax, %%gs\n"
+            : : "i" (KERNEL_CS), "i" (KERNEL_DS), "i" (PERCPU_SELECTOR) : "eax");
+
+    asm volatile("ltr %w0" : : "r" (TSS_SELECTOR));
+}
+
+void tss_set_kernel_stack(uint32_t esp0) {
+    tss.esp0 = esp0;
+}
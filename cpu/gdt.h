@@ -0,0 +1,50 @@
+#pragma once
+
+#include <stdint.h>
+
+/* Segment selectors. The order of the first four is dictated by sysenter/sysexit:
+ * kernel code, kernel data, user code, user data. */
+#define KERNEL_CS 0x08
+#define KERNEL_DS 0x10
+#define USER_CS (0x18 | 3)
+#define USER_DS (0x20 | 3)
+#define TSS_SELECTOR 0x28
+#define PERCPU_SELECTOR 0x30 /* kernel data based at the CPU's percpu_t, loaded into GS */
+
+#define GDT_ENTRIES 7
+
+/* How every segment descriptor is defined */
+typedef struct {
+    uint16_t limit_low; /* Segment limit, bits 0-15 */
+    uint16_t base_low; /* Segment base, bits 0-15 */
+    uint8_t base_middle; /* Segment base, bits 16-23 */
+    /* Present, privilege level (0=kernel..3=user), type */
+    uint8_t access;
+    /* Granularity and size flags (upper 4 bits) + segment limit, bits 16-19 */
+    uint8_t granularity;
+    uint8_t base_high; /* Segment base, bits 24-31 */
+} __attribute__((packed)) gdt_entry_t;
+
+typedef struct {
+    uint16_t limit;
+    uint32_t base;
+} __attribute__((packed)) gdt_register_t;
+
+/* Task state segment. We don't use hardware task switching, the CPU only
+ * reads esp0/ss0 to find the kernel stack when an interrupt arrives in ring 3 */
+typedef struct {
+    uint32_t prev_tss;
+    uint32_t esp0, ss0;
+    uint32_t esp1, ss1;
+    uint32_t esp2, ss2;
+    uint32_t cr3, eip, eflags;
+    uint32_t eax, ecx, edx, ebx, esp, ebp, esi, edi;
+    uint32_t es, cs, ss, ds, fs, gs;
+    uint32_t ldt;
+    uint16_t trap, iomap_base;
+} __attribute__((packed)) tss_t;
+
+void gdt_install();
+
+/* Stack the CPU switches to when ring 3 is interrupted */
+void tss_set_kernel_stack(uint32_t esp0);
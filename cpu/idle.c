@@ -0,0 +1,113 @@
+#include "idle.h"
+#include "percpu.h"
+#include "timer.h"
+#include "tsc.h"
+#include "../drivers/display.h"
+#include "../kernel/mem.h"
+#include "../kernel/thread.h"
+#include "../kernel/util.h"
+
+/* exp(-5s/1min), exp(-5s/5min) and exp(-5s/15min) in fixed point */
+static const uint32_t load_decay[3] = {1884, 2014, 2037};
+
+static cpu_stats_t cpu_stats;
+static volatile bool idling = false;
+static uint64_t idle_since;
+
+static timer_t load_timer;
+static uint64_t sample_tsc;
+static uint64_t sample_idle_cycles;
+
+/* part/whole in fixed point, without 64 bit division */
+static uint32_t fixed_fraction(uint64_t part, uint64_t whole) {
+    while (whole >> 20) {
+        whole >>= 1;
+        part >>= 1;
+    }
+    return whole == 0 ? 0 : (uint32_t) part * LOAD_FIXED_1 / (uint32_t) whole;
+}
+
+static void sample_load(void *data) {
+    uint64_t now = rdtsc();
+    uint64_t total = now - sample_tsc;
+    uint64_t idle = cpu_stats.idle_cycles - sample_idle_cycles;
+    sample_tsc = now;
+    sample_idle_cycles = cpu_stats.idle_cycles;
+
+    uint32_t busy = fixed_fraction(total - idle, total);
+    for (int i = 0; i < 3; i++) {
+        cpu_stats.load[i] = (cpu_stats.load[i] * load_decay[i] + busy * (LOAD_FIXED_1 - load_decay[i])) >> LOAD_FSHIFT;
+    }
+    timer_add(&load_timer, get_tick() + LOAD_SAMPLE_SECONDS * TIMER_FREQUENCY);
+}
+
+void init_idle() {
+    cpu_stats.start_tsc = rdtsc();
+    sample_tsc = cpu_stats.start_tsc;
+    timer_setup(&load_timer, sample_load, NULL_POINTER);
+    timer_add(&load_timer, get_tick() + LOAD_SAMPLE_SECONDS * TIMER_FREQUENCY);
+}
+
+void cpu_idle() {
+    for (;;) {
+        asm volatile("cli");
+        if (threads_runnable()) {
+            /* Comes back here once nothing is runnable anymore */
+            schedule();
+            continue;
+        }
+        idle_since = rdtsc();
+        idling = true;
+        /* 'sti' only takes effect after 'hlt', so no interrupt is lost in between */
+        asm volatile("sti; hlt" : : : "memory");
+    }
+}
+
+void idle_interrupt_entry() {
+    if (idling) {
+        idling = false;
+        cpu_stats.idle_cycles += rdtsc() - idle_since;
+    }
+}
+
+cpu_stats_t *get_cpu_stats() {
+    return &cpu_stats;
+}
+
+/* 'value' in fixed point with two decimals */
+static void print_fixed(uint32_t value) {
+    char ascii[12];
+    int_to_string(value >> LOAD_FSHIFT, ascii);
+    print_string(ascii);
+    uint32_t hundredths = ((value & (LOAD_FIXED_1 - 1)) * 100) >> LOAD_FSHIFT;
+    print_string(hundredths < 10 ? ".0" : ".");
+    int_to_string(hundredths, ascii);
+    print_string(ascii);
+}
+
+void print_load() {
+    char ascii[12];
+    int_to_string(get_tick() / TIMER_FREQUENCY, ascii);
+    print_string("up ");
+    print_string(ascii);
+    print_string("s, load average: ");
+    for (int i = 0; i < 3; i++) {
+        print_fixed(cpu_stats.load[i]);
+        print_string(i < 2 ? ", " : "");
+    }
+
+    uint32_t idle = fixed_fraction(cpu_stats.idle_cycles, rdtsc() - cpu_stats.start_tsc);
+    int_to_string((idle * 100) >> LOAD_FSHIFT, ascii);
+    print_string(", idle ");
+    print_string(ascii);
+    print_string("%\n");
+
+    /* This CPU's counters */
+    uint32_t counters[] = {this_cpu_read(interrupts), this_cpu_read(context_switches), this_cpu_read(syscalls)};
+    char *names[] = {" interrupts, ", " context switches, ", " system calls\n"};
+    for (int i = 0; i < 3; i++) {
+        int_to_string(counters[i], ascii);
+        print_string(ascii);
+        print_string(names[i]);
+    }
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <stdint.h>
+
+/* Load averages are fixed point numbers like Linux's: LOAD_FIXED_1 is 1.0.
+ * With no scheduler yet the sample is the fraction of the last period the
+ * CPU was busy, so 1.0 means it never went idle. */
+#define LOAD_FSHIFT 11
+#define LOAD_FIXED_1 (1 << LOAD_FSHIFT)
+#define LOAD_SAMPLE_SECONDS 5
+
+typedef struct {
+    uint64_t start_tsc;
+    uint64_t idle_cycles;
+    uint32_t load[3]; /* 1, 5 and 15 minute averages */
+} cpu_stats_t;
+
+void init_idle();
+
+/* What the boot CPU does once main returns: run the idle thread, which
+ * hands the CPU to runnable threads and halts when there are none */
+void cpu_idle();
+
+/* Called at the start of every IRQ, ends the idle period it woke up from */
+void idle_interrupt_entry();
+
+cpu_stats_t *get_cpu_stats();
+
+void print_load();
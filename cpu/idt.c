@@ -12,6 +12,11 @@ void set_idt_gate(int n, uint32_t handler) {
     idt[n].high_offset = high_16(handler);
 }
 
+void set_user_idt_gate(int n, uint32_t handler) {
+    set_idt_gate(n, handler);
+    idt[n].flags = 0xEE; /* DPL 3 */
+}
+
 void load_idt() {
     idt_reg.base = (uint32_t) &idt;
     idt_reg.limit = IDT_ENTRIES * sizeof(idt_gate_t) - 1;
@@ -1,9 +1,7 @@
 #pragma once
 
 #include <stdint.h>
-
-/* Segment selectors */
-#define KERNEL_CS 0x08
+#include "gdt.h"
 
 /* How every interrupt gate (handler) is defined */
 typedef struct {
@@ -30,4 +28,7 @@ typedef struct {
 
 void set_idt_gate(int n, uint32_t handler);
 
+/* Same as set_idt_gate, but the gate can be invoked with 'int' from ring 3 */
+void set_user_idt_gate(int n, uint32_t handler);
+
 void load_idt();
\ No newline at end of file
@@ -1,47 +1,20 @@
 #include "isr.h"
 #include "idt.h"
+#include "idle.h"
+#include "percpu.h"
+#include "syscall.h"
+#include "tsc.h"
 #include "../drivers/display.h"
 #include "../drivers/ports.h"
+#include "../kernel/ksyms.h"
 #include "../kernel/util.h"
 
-isr_t interrupt_handlers[256];
+static interrupt_action_t interrupt_actions[MAX_INTERRUPT_ACTIONS];
+static int interrupt_action_count = 0;
+static interrupt_action_t *interrupt_chains[256];
+static uint32_t unclaimed_interrupts[256];
 
-/* Can't do this with a loop because we need the address
- * of the function names */
 void isr_install() {
-    set_idt_gate(0, (uint32_t) isr0);
-    set_idt_gate(1, (uint32_t) isr1);
-    set_idt_gate(2, (uint32_t) isr2);
-    set_idt_gate(3, (uint32_t) isr3);
-    set_idt_gate(4, (uint32_t) isr4);
-    set_idt_gate(5, (uint32_t) isr5);
-    set_idt_gate(6, (uint32_t) isr6);
-    set_idt_gate(7, (uint32_t) isr7);
-    set_idt_gate(8, (uint32_t) isr8);
-    set_idt_gate(9, (uint32_t) isr9);
-    set_idt_gate(10, (uint32_t) isr10);
-    set_idt_gate(11, (uint32_t) isr11);
-    set_idt_gate(12, (uint32_t) isr12);
-    set_idt_gate(13, (uint32_t) isr13);
-    set_idt_gate(14, (uint32_t) isr14);
-    set_idt_gate(15, (uint32_t) isr15);
-    set_idt_gate(16, (uint32_t) isr16);
-    set_idt_gate(17, (uint32_t) isr17);
-    set_idt_gate(18, (uint32_t) isr18);
-    set_idt_gate(19, (uint32_t) isr19);
-    set_idt_gate(20, (uint32_t) isr20);
-    set_idt_gate(21, (uint32_t) isr21);
-    set_idt_gate(22, (uint32_t) isr22);
-    set_idt_gate(23, (uint32_t) isr23);
-    set_idt_gate(24, (uint32_t) isr24);
-    set_idt_gate(25, (uint32_t) isr25);
-    set_idt_gate(26, (uint32_t) isr26);
-    set_idt_gate(27, (uint32_t) isr27);
-    set_idt_gate(28, (uint32_t) isr28);
-    set_idt_gate(29, (uint32_t) isr29);
-    set_idt_gate(30, (uint32_t) isr30);
-    set_idt_gate(31, (uint32_t) isr31);
-
     // Remap the PIC
     port_byte_out(0x20, 0x11);
     port_byte_out(0xA0, 0x11);
@@ -54,23 +27,10 @@ void isr_install() {
     port_byte_out(0x21, 0x0);
     port_byte_out(0xA1, 0x0);
 
-    // Install the IRQs
-    set_idt_gate(32, (uint32_t)irq0);
-    set_idt_gate(33, (uint32_t)irq1);
-    set_idt_gate(34, (uint32_t)irq2);
-    set_idt_gate(35, (uint32_t)irq3);
-    set_idt_gate(36, (uint32_t)irq4);
-    set_idt_gate(37, (uint32_t)irq5);
-    set_idt_gate(38, (uint32_t)irq6);
-    set_idt_gate(39, (uint32_t)irq7);
-    set_idt_gate(40, (uint32_t)irq8);
-    set_idt_gate(41, (uint32_t)irq9);
-    set_idt_gate(42, (uint32_t)irq10);
-    set_idt_gate(43, (uint32_t)irq11);
-    set_idt_gate(44, (uint32_t)irq12);
-    set_idt_gate(45, (uint32_t)irq13);
-    set_idt_gate(46, (uint32_t)irq14);
-    set_idt_gate(47, (uint32_t)irq15);
+    // Install the exception handlers and the IRQs
+    for (int n = 0; n < ISR_STUB_COUNT; n++) {
+        set_idt_gate(n, isr_stub_table[n]);
+    }
 
     load_idt(); // Load with ASM
 }
@@ -114,30 +74,126 @@ char *exception_messages[] = {
         "Reserved"
 };
 
+static int latency_bucket(uint64_t cycles) {
+    if (cycles >> 32) {
+        return LATENCY_BUCKETS - 1;
+    }
+    return cycles == 0 ? 0 : 31 - __builtin_clz((uint32_t) cycles);
+}
+
+/* Run every handler on the vector, timing each. Returns whether any claimed it. */
+static bool run_interrupt_chain(registers_t *r) {
+    bool claimed = false;
+    for (interrupt_action_t *action = interrupt_chains[r->int_no]; action != 0; action = action->next) {
+        uint64_t start = rdtsc();
+        bool handled = action->handler(r);
+        action->latency[latency_bucket(rdtsc() - start)]++;
+        action->calls++;
+        if (handled) {
+            action->claimed++;
+            claimed = true;
+        }
+    }
+    return claimed;
+}
+
 void isr_handler(registers_t *r) {
+    /* Exceptions a subsystem knows how to recover from (e.g. #NM) */
+    if (run_interrupt_chain(r)) {
+        return;
+    }
+
     print_string("received interrupt: ");
-    char s[3];
+    char s[16];
     int_to_string(r->int_no, s);
     print_string(s);
     print_nl();
     print_string(exception_messages[r->int_no]);
+    print_string(", error code ");
+    hex_to_string(r->err_code, s);
+    print_string(s);
     print_nl();
+    print_string("at ");
+    if ((r->cs & 3) == 3) {
+        /* Returning would only fault again, the program dies instead */
+        hex_to_string(r->eip, s);
+        print_string(s);
+        print_nl();
+        user_mode_exit((uint32_t) -1);
+    }
+    print_symbol(r->eip);
+    print_nl();
+    print_backtrace(r->ebp);
+    print_string("Kernel exception, halting.\n");
+    asm volatile("cli; hlt");
 }
 
 void register_interrupt_handler(uint8_t n, isr_t handler) {
-    interrupt_handlers[n] = handler;
+    if (interrupt_action_count == MAX_INTERRUPT_ACTIONS) {
+        print_string("Too many interrupt handlers.\n");
+        return;
+    }
+    interrupt_action_t *action = &interrupt_actions[interrupt_action_count++];
+    action->handler = handler;
+
+    /* Appended, so handlers run in the order they were registered */
+    uint32_t flags = irq_save();
+    interrupt_action_t **link = &interrupt_chains[n];
+    while (*link != 0) {
+        link = &(*link)->next;
+    }
+    *link = action;
+    irq_restore(flags);
 }
 
 void irq_handler(registers_t *r) {
+    idle_interrupt_entry();
+    this_cpu_inc(interrupts);
+
     /* Handle the interrupt in a more modular way */
-    if (interrupt_handlers[r->int_no] != 0) {
-        isr_t handler = interrupt_handlers[r->int_no];
-        handler(r);
+    if (!run_interrupt_chain(r)) {
+        unclaimed_interrupts[r->int_no]++;
     }
 
-    // EOI
+    /* EOI last: no handler sleeps or switches threads, and the PIC holds
+     * this line back until every handler on it has serviced its device */
     if (r->int_no >= 40) {
         port_byte_out(0xA0, 0x20); /* follower */
     }
     port_byte_out(0x20, 0x20); /* leader */
-}
\ No newline at end of file
+}
+
+void print_interrupt_stats() {
+    for (int vector = 0; vector < 256; vector++) {
+        for (interrupt_action_t *action = interrupt_chains[vector]; action != 0; action = action->next) {
+            if (action->calls == 0) {
+                continue;
+            }
+            uint32_t offset;
+            const char *name = ksym_lookup((uint32_t) action->handler, &offset);
+            print_number(vector);
+            print_string(" ");
+            print_string(name != 0 ? (char *) name : "?");
+            print_string(": ");
+            print_number(action->calls);
+            print_string(" calls, ");
+            print_number(action->claimed);
+            print_string(" claimed; log2(cycles):count");
+            for (int bucket = 0; bucket < LATENCY_BUCKETS; bucket++) {
+                if (action->latency[bucket] != 0) {
+                    print_string(" ");
+                    print_number(bucket);
+                    print_string(":");
+                    print_number(action->latency[bucket]);
+                }
+            }
+            print_nl();
+        }
+        if (unclaimed_interrupts[vector] != 0) {
+            print_number(vector);
+            print_string(" unclaimed: ");
+            print_number(unclaimed_interrupts[vector]);
+            print_nl();
+        }
+    }
+}
@@ -1,104 +1,16 @@
 #pragma once
 
 #include <stdint.h>
+#include <stdbool.h>
 
-/* ISRs reserved for CPU exceptions */
-extern void isr0();
+/* Entry stubs generated in interrupt.asm, indexed by vector:
+ * 0-31 are the CPU exceptions, 32-47 the remapped IRQs */
+#define ISR_STUB_COUNT 48
 
-extern void isr1();
+extern uint32_t isr_stub_table[ISR_STUB_COUNT];
 
-extern void isr2();
-
-extern void isr3();
-
-extern void isr4();
-
-extern void isr5();
-
-extern void isr6();
-
-extern void isr7();
-
-extern void isr8();
-
-extern void isr9();
-
-extern void isr10();
-
-extern void isr11();
-
-extern void isr12();
-
-extern void isr13();
-
-extern void isr14();
-
-extern void isr15();
-
-extern void isr16();
-
-extern void isr17();
-
-extern void isr18();
-
-extern void isr19();
-
-extern void isr20();
-
-extern void isr21();
-
-extern void isr22();
-
-extern void isr23();
-
-extern void isr24();
-
-extern void isr25();
-
-extern void isr26();
-
-extern void isr27();
-
-extern void isr28();
-
-extern void isr29();
-
-extern void isr30();
-
-extern void isr31();
-
-/* IRQ definitions */
-extern void irq0();
-
-extern void irq1();
-
-extern void irq2();
-
-extern void irq3();
-
-extern void irq4();
-
-extern void irq5();
-
-extern void irq6();
-
-extern void irq7();
-
-extern void irq8();
-
-extern void irq9();
-
-extern void irq10();
-
-extern void irq11();
-
-extern void irq12();
-
-extern void irq13();
-
-extern void irq14();
-
-extern void irq15();
+/* int 0x80 system call gate */
+extern void isr128();
 
 #define IRQ0 32
 #define IRQ1 33
@@ -122,9 +34,10 @@ extern void irq15();
  * - Pushed by the processor automatically
  * - `push byte`s on the isr-specific code: error code, then int number
  * - All the registers by pusha
- * - `push eax` whose lower 16-bits contain DS
+ * - `push eax` whose lower 16-bits contain DS, then the same for GS
  */
 typedef struct {
+    uint32_t gs; /* Per-CPU segment selector, or the user's */
     uint32_t ds; /* Data segment selector */
     uint32_t edi, esi, ebp, esp, ebx, edx, ecx, eax; /* Pushed by pusha. */
     uint32_t int_no, err_code; /* Interrupt number and error code (if applicable) */
@@ -135,6 +48,37 @@ void isr_install();
 
 void isr_handler(registers_t *r);
 
-typedef void (*isr_t)(registers_t *);
+/* Handlers return whether the interrupt was theirs. Several handlers may
+ * share a vector (e.g. PCI devices on one line); all of them run. */
+typedef bool (*isr_t)(registers_t *);
+
+#define IRQ_NONE false
+#define IRQ_HANDLED true
+
+#define MAX_INTERRUPT_ACTIONS 32
+#define LATENCY_BUCKETS 32 /* bucket n counts runs of 2^n to 2^(n+1)-1 cycles */
+
+typedef struct interrupt_action {
+    isr_t handler;
+    uint32_t calls;
+    uint32_t claimed;
+    uint32_t latency[LATENCY_BUCKETS];
+    struct interrupt_action *next;
+} interrupt_action_t;
+
+/* Add 'handler' to the chain of vector 'n' */
+void register_interrupt_handler(uint8_t n, isr_t handler);
+
+/* Per handler call counts and execution time histograms */
+void print_interrupt_stats();
+
+/* Disable interrupts, returning the previous EFLAGS for irq_restore */
+static inline uint32_t irq_save() {
+    uint32_t flags;
+    asm volatile("pushf; pop %0; cli" : "=r" (flags) : : "memory");
+    return flags;
+}
 
-void register_interrupt_handler(uint8_t n, isr_t handler);
\ No newline at end of file
+static inline void irq_restore(uint32_t flags) {
+    asm volatile("push %0; popf" : : "r" (flags) : "memory", "cc");
+}
\ No newline at end of file
@@ -0,0 +1,369 @@
+#include "paging.h"
+#include "isr.h"
+#include "syscall.h"
+#include "../drivers/display.h"
+#include "../kernel/mem.h"
+#include "../kernel/ksyms.h"
+#include "../kernel/multiboot.h"
+#include "../kernel/util.h"
+
+#define CR0_WP (1 << 16) /* honour read-only pages in ring 0 too, needed for copy-on-write */
+#define CR0_PG (1 << 31)
+
+#define PAGE_FAULT_PRESENT 0x1 /* error code bits */
+#define PAGE_FAULT_WRITE 0x2
+#define PAGE_FAULT_USER 0x4
+
+#define PDE_INDEX(address) ((address) >> 22)
+#define PTE_INDEX(address) (((address) >> 12) & 0x3FF)
+#define IDENTITY_TABLES (IDENTITY_MAP_SIZE / (PAGE_SIZE * 1024))
+
+/* Provided by linker.ld */
+extern uint8_t __user_start[], __user_end[];
+
+static uint32_t kernel_page_directory[1024] __attribute__((aligned(PAGE_SIZE)));
+static uint32_t identity_page_tables[IDENTITY_TABLES][1024] __attribute__((aligned(PAGE_SIZE)));
+static uint32_t heap_page_table[1024] __attribute__((aligned(PAGE_SIZE)));
+static uint32_t heap_pages = 0;
+static address_space_t *current_space = NULL_POINTER;
+
+/* Free frames are kept on a stack, each frame has a reference count */
+static uint32_t free_frame_stack[FRAME_COUNT];
+static uint32_t free_frame_count = 0;
+static uint8_t frame_refs[FRAME_COUNT];
+
+#define FRAME_INDEX(frame) (((frame) - FRAME_POOL_START) / PAGE_SIZE)
+
+/* Interrupts are disabled around the frame stack, a heap fault in an IRQ
+ * handler may allocate in the middle of someone else's call */
+uint32_t frame_alloc() {
+    uint32_t flags = irq_save();
+    uint32_t frame = 0;
+    if (free_frame_count > 0) {
+        frame = free_frame_stack[--free_frame_count];
+        frame_refs[FRAME_INDEX(frame)] = 1;
+    }
+    irq_restore(flags);
+    return frame;
+}
+
+void frame_ref(uint32_t frame) {
+    uint32_t flags = irq_save();
+    frame_refs[FRAME_INDEX(frame)]++;
+    irq_restore(flags);
+}
+
+void frame_unref(uint32_t frame) {
+    uint32_t flags = irq_save();
+    if (--frame_refs[FRAME_INDEX(frame)] == 0) {
+        free_frame_stack[free_frame_count++] = frame;
+    }
+    irq_restore(flags);
+}
+
+uint32_t frame_refcount(uint32_t frame) {
+    return frame_refs[FRAME_INDEX(frame)];
+}
+
+uint32_t frames_free() {
+    return free_frame_count;
+}
+
+static void init_frames() {
+    uint32_t end = FRAME_POOL_END;
+    /* Don't hand out memory that isn't there */
+    if (multiboot_info != NULL_POINTER && (multiboot_info->flags & MULTIBOOT_INFO_MEMORY)) {
+        uint32_t top = 0x100000 + multiboot_info->mem_upper * 1024;
+        if (top < end) {
+            end = top & PAGE_MASK;
+        }
+    }
+    /* Push in reverse, so the lowest frames are handed out first */
+    for (uint32_t frame = end; frame > FRAME_POOL_START; frame -= PAGE_SIZE) {
+        free_frame_stack[free_frame_count++] = frame - PAGE_SIZE;
+    }
+}
+
+static void zero_frame(uint32_t frame) {
+    uint32_t *words = (uint32_t *) frame;
+    for (int i = 0; i < PAGE_SIZE / 4; i++) {
+        words[i] = 0;
+    }
+}
+
+static inline void invalidate_page(uint32_t address) {
+    asm volatile("invlpg (%0)" : : "r" (address) : "memory");
+}
+
+static uint32_t *active_page_directory() {
+    return current_space != NULL_POINTER ? current_space->page_directory : kernel_page_directory;
+}
+
+/* Entry for 'address' in 'directory', creating the page table if needed */
+static uint32_t *get_pte(uint32_t *directory, uint32_t address, bool create) {
+    uint32_t *pde = &directory[PDE_INDEX(address)];
+    if (!(*pde & PAGE_PRESENT)) {
+        if (!create) {
+            return NULL_POINTER;
+        }
+        uint32_t table = frame_alloc();
+        if (table == 0) {
+            return NULL_POINTER;
+        }
+        zero_frame(table);
+        /* Permissions are enforced at the page level */
+        *pde = table | PAGE_PRESENT | PAGE_WRITE | PAGE_USER;
+    }
+    uint32_t *table = (uint32_t *) (*pde & PAGE_MASK);
+    return &table[PTE_INDEX(address)];
+}
+
+bool address_space_init(address_space_t *space) {
+    uint32_t directory = frame_alloc();
+    if (directory == 0) {
+        return false;
+    }
+    space->page_directory = (uint32_t *) directory;
+    /* Share the kernel's page tables, user mappings go into fresh ones */
+    for (int i = 0; i < 1024; i++) {
+        space->page_directory[i] = kernel_page_directory[i];
+    }
+    space->region_count = 0;
+    space->pages_mapped = 0;
+    space->page_faults = 0;
+    space->cow_copies = 0;
+    return true;
+}
+
+void address_space_destroy(address_space_t *space) {
+    if (space == current_space) {
+        switch_address_space(NULL_POINTER);
+    }
+    for (int i = 0; i < 1024; i++) {
+        uint32_t pde = space->page_directory[i];
+        if (!(pde & PAGE_PRESENT) || pde == kernel_page_directory[i]) {
+            continue;
+        }
+        uint32_t *table = (uint32_t *) (pde & PAGE_MASK);
+        for (int j = 0; j < 1024; j++) {
+            if (table[j] & PAGE_PRESENT) {
+                frame_unref(table[j] & PAGE_MASK);
+            }
+        }
+        frame_unref(pde & PAGE_MASK);
+    }
+    frame_unref((uint32_t) space->page_directory);
+}
+
+vm_region_t *address_space_add_region(address_space_t *space, uint32_t start, uint32_t end, uint32_t flags) {
+    if (space->region_count == MAX_VM_REGIONS || start < IDENTITY_MAP_SIZE || end <= start) {
+        return NULL_POINTER;
+    }
+    vm_region_t *region = &space->regions[space->region_count++];
+    region->start = start & PAGE_MASK;
+    region->end = PAGE_ALIGN_UP(end);
+    region->flags = flags;
+    region->populate = populate_zero;
+    region->data = NULL_POINTER;
+    return region;
+}
+
+void switch_address_space(address_space_t *space) {
+    current_space = space;
+    asm volatile("mov %0, %%cr3" : : "r" (active_page_directory()) : "memory");
+}
+
+uint32_t populate_zero(vm_region_t *region, uint32_t page, bool *shared) {
+    uint32_t frame = frame_alloc();
+    if (frame != 0) {
+        zero_frame(frame);
+    }
+    *shared = false;
+    return frame;
+}
+
+static vm_region_t *find_region(address_space_t *space, uint32_t address) {
+    for (int i = 0; i < space->region_count; i++) {
+        if (address >= space->regions[i].start && address < space->regions[i].end) {
+            return &space->regions[i];
+        }
+    }
+    return NULL_POINTER;
+}
+
+bool user_address_ok(uint32_t address) {
+    return current_space != NULL_POINTER && address < USER_SPACE_END
+           && find_region(current_space, address) != NULL_POINTER;
+}
+
+/* Private, writable copy of a shared frame */
+static uint32_t copy_frame(uint32_t frame) {
+    uint32_t copy = frame_alloc();
+    if (copy != 0) {
+        memory_copy((uint8_t *) frame, (uint8_t *) copy, PAGE_SIZE);
+        frame_unref(frame);
+    }
+    return copy;
+}
+
+/* Returns false if the fault can't be resolved */
+static bool handle_user_fault(address_space_t *space, uint32_t address, uint32_t error) {
+    vm_region_t *region = find_region(space, address);
+    bool write = error & PAGE_FAULT_WRITE;
+    if (region == NULL_POINTER || (write && !(region->flags & VM_WRITE))) {
+        return false;
+    }
+
+    uint32_t page = address & PAGE_MASK;
+    uint32_t *pte = get_pte(space->page_directory, page, true);
+    if (pte == NULL_POINTER) {
+        return false;
+    }
+    space->page_faults++;
+
+    if (!(error & PAGE_FAULT_PRESENT)) {
+        /* First touch */
+        bool shared;
+        uint32_t frame = region->populate(region, page, &shared);
+        if (frame == 0) {
+            return false;
+        }
+        if (shared && write) {
+            frame = copy_frame(frame);
+            space->cow_copies++;
+            shared = false;
+        }
+        if (frame == 0) {
+            return false;
+        }
+        uint32_t flags = PAGE_PRESENT | PAGE_USER;
+        if ((region->flags & VM_WRITE) && !shared) {
+            flags |= PAGE_WRITE;
+        }
+        *pte = frame | flags;
+        space->pages_mapped++;
+    } else {
+        /* Write to a shared page of a writable region: copy on write,
+         * unless every other user has let go of it in the meantime */
+        uint32_t frame = *pte & PAGE_MASK;
+        if (frame_refcount(frame) > 1) {
+            frame = copy_frame(frame);
+            if (frame == 0) {
+                return false;
+            }
+            space->cow_copies++;
+        }
+        *pte = frame | PAGE_PRESENT | PAGE_USER | PAGE_WRITE;
+    }
+    invalidate_page(page);
+    return true;
+}
+
+static bool in_heap(uint32_t address) {
+    return address >= KERNEL_HEAP_START && address - KERNEL_HEAP_START < KERNEL_HEAP_SIZE;
+}
+
+/* First touch of a heap page */
+static bool handle_heap_fault(uint32_t address, uint32_t error) {
+    if (error & (PAGE_FAULT_PRESENT | PAGE_FAULT_USER)) {
+        return false;
+    }
+    uint32_t frame = frame_alloc();
+    if (frame == 0) {
+        return false;
+    }
+    uint32_t page = address & PAGE_MASK;
+    heap_page_table[PTE_INDEX(page)] = frame | PAGE_PRESENT | PAGE_WRITE;
+    heap_pages++;
+    invalidate_page(page);
+    return true;
+}
+
+void heap_release(uint32_t start, uint32_t end) {
+    for (uint32_t page = PAGE_ALIGN_UP(start); page + PAGE_SIZE <= end; page += PAGE_SIZE) {
+        uint32_t *pte = &heap_page_table[PTE_INDEX(page)];
+        if (*pte & PAGE_PRESENT) {
+            frame_unref(*pte & PAGE_MASK);
+            *pte = 0;
+            heap_pages--;
+            invalidate_page(page);
+        }
+    }
+}
+
+uint32_t heap_pages_mapped() {
+    return heap_pages;
+}
+
+uint32_t virtual_to_physical(uint32_t address) {
+    uint32_t *pte = get_pte(active_page_directory(), address, false);
+    if (pte == NULL_POINTER || !(*pte & PAGE_PRESENT)) {
+        return 0;
+    }
+    return (*pte & PAGE_MASK) | (address & ~PAGE_MASK);
+}
+
+static bool page_fault_handler(registers_t *r) {
+    uint32_t address;
+    asm volatile("mov %%cr2, %0" : "=r" (address));
+
+    if (in_heap(address)) {
+        if (handle_heap_fault(address, r->err_code)) {
+            return IRQ_HANDLED;
+        }
+    } else if (current_space != NULL_POINTER && handle_user_fault(current_space, address, r->err_code)) {
+        return IRQ_HANDLED;
+    }
+
+    char hex[16];
+    print_string("Page fault at ");
+    hex_to_string(address, hex);
+    print_string(hex);
+    print_string(", eip ");
+    if (r->err_code & PAGE_FAULT_USER) {
+        hex_to_string(r->eip, hex);
+        print_string(hex);
+        print_nl();
+    } else {
+        print_symbol(r->eip);
+        print_nl();
+        print_backtrace(r->ebp);
+    }
+
+    if (r->err_code & PAGE_FAULT_USER) {
+        /* Only the program dies */
+        user_mode_exit((uint32_t) -1);
+    }
+    print_string("Kernel page fault, halting.\n");
+    asm volatile("cli; hlt");
+    return IRQ_HANDLED; /* not reached */
+}
+
+void init_paging() {
+    init_frames();
+
+    uint32_t user_start = (uint32_t) __user_start;
+    uint32_t user_end = (uint32_t) __user_end;
+    for (int t = 0; t < IDENTITY_TABLES; t++) {
+        for (int i = 0; i < 1024; i++) {
+            uint32_t address = (t * 1024 + i) * PAGE_SIZE;
+            uint32_t flags = PAGE_PRESENT | PAGE_WRITE;
+            if (address >= user_start && address < user_end) {
+                flags |= PAGE_USER;
+            }
+            identity_page_tables[t][i] = address | flags;
+        }
+        kernel_page_directory[t] = (uint32_t) identity_page_tables[t] | PAGE_PRESENT | PAGE_WRITE | PAGE_USER;
+    }
+
+    /* The heap's table is shared by every address space, which copy the kernel's directory */
+    kernel_page_directory[PDE_INDEX(KERNEL_HEAP_START)] = (uint32_t) heap_page_table | PAGE_PRESENT | PAGE_WRITE;
+
+    register_interrupt_handler(14, page_fault_handler);
+    switch_address_space(NULL_POINTER);
+
+    uint32_t cr0;
+    asm volatile("mov %%cr0, %0" : "=r" (cr0));
+    cr0 |= CR0_PG | CR0_WP;
+    asm volatile("mov %0, %%cr0" : : "r" (cr0));
+}
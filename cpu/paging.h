@@ -0,0 +1,84 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define PAGE_SIZE 4096
+#define PAGE_MASK (~(PAGE_SIZE - 1))
+#define PAGE_ALIGN_UP(address) (((address) + PAGE_SIZE - 1) & PAGE_MASK)
+
+/* Page directory/table entry flags */
+#define PAGE_PRESENT 0x1
+#define PAGE_WRITE 0x2
+#define PAGE_USER 0x4
+
+/* The first 16 MiB are identity mapped in every address space, kernel only
+ * (except the .user section). Frames handed out by frame_alloc come from
+ * above FRAME_POOL_START, so the kernel can reach them at their physical
+ * address. */
+#define IDENTITY_MAP_SIZE (16 * 1024 * 1024)
+#define FRAME_POOL_START (4 * 1024 * 1024)
+#define FRAME_POOL_END IDENTITY_MAP_SIZE
+#define FRAME_COUNT ((FRAME_POOL_END - FRAME_POOL_START) / PAGE_SIZE)
+
+/* User mappings stay below, the kernel owns everything above */
+#define USER_SPACE_END 0xC0000000
+
+/* Kernel heap: reserved in every address space, a frame is only put behind
+ * a page when it is first touched (see mem.c) */
+#define KERNEL_HEAP_START 0xD0000000
+#define KERNEL_HEAP_SIZE (4 * 1024 * 1024) /* one page table */
+
+/* Physical frames, reference counted so that pages can be shared */
+uint32_t frame_alloc();
+void frame_ref(uint32_t frame);
+void frame_unref(uint32_t frame);
+uint32_t frame_refcount(uint32_t frame);
+uint32_t frames_free();
+
+#define VM_WRITE 0x1
+
+/* A range of a user address space whose pages are created on first touch */
+typedef struct vm_region {
+    uint32_t start, end; /* page aligned, end exclusive */
+    uint32_t flags;
+    /* Supply the frame for 'page', with a reference taken for the new mapping.
+     * Set 'shared' if other mappings may use the same frame, it is then mapped
+     * read-only and copied on the first write. Return 0 when out of memory. */
+    uint32_t (*populate)(struct vm_region *region, uint32_t page, bool *shared);
+    void *data; /* for populate */
+} vm_region_t;
+
+#define MAX_VM_REGIONS 8
+
+typedef struct {
+    uint32_t *page_directory;
+    vm_region_t regions[MAX_VM_REGIONS];
+    int region_count;
+    uint32_t pages_mapped;
+    uint32_t page_faults;
+    uint32_t cow_copies;
+} address_space_t;
+
+void init_paging();
+
+bool address_space_init(address_space_t *space);
+void address_space_destroy(address_space_t *space);
+vm_region_t *address_space_add_region(address_space_t *space, uint32_t start, uint32_t end, uint32_t flags);
+void switch_address_space(address_space_t *space); /* NULL for the kernel's */
+
+/* Give the frames behind the whole heap pages in [start, end) back */
+void heap_release(uint32_t start, uint32_t end);
+
+uint32_t heap_pages_mapped();
+
+/* Physical address behind 'address' in the current address space, 0 if
+ * nothing is mapped there (yet). For handing buffers to DMA. */
+uint32_t virtual_to_physical(uint32_t address);
+
+/* Whether a user program may make the kernel read 'address': it has to be
+ * inside a region of the current address space */
+bool user_address_ok(uint32_t address);
+
+/* populate callback for anonymous memory (stack, bss) */
+uint32_t populate_zero(vm_region_t *region, uint32_t page, bool *shared);
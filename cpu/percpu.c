@@ -0,0 +1,7 @@
+#include "percpu.h"
+
+static percpu_t boot_cpu = {.self = &boot_cpu, .cpu = 0};
+
+percpu_t *boot_percpu() {
+    return &boot_cpu;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+struct thread;
+
+/* State that belongs to one CPU. GS points at the CPU's own block through a
+ * data segment based there (PERCPU_SELECTOR), so fields are reached with a
+ * single %gs-relative instruction: no lock, no pointer to load first, and
+ * each block sits on its own cache lines. Fields must be 32 bits wide. */
+typedef struct percpu {
+    struct percpu *self; /* the block's linear address, for taking pointers into it */
+    uint32_t cpu;
+    struct thread *current_thread;
+    volatile uint32_t tick; /* timer interrupts seen */
+    uint32_t interrupts; /* IRQs taken */
+    uint32_t context_switches;
+    uint32_t syscalls;
+} __attribute__((aligned(64))) percpu_t;
+
+/* Only the boot CPU is brought up so far */
+percpu_t *boot_percpu();
+
+#define this_cpu_read(field) ({ \
+        __typeof__(((percpu_t *) 0)->field) percpu_value; \
+        asm volatile("movl %%gs:%c1, %0" : "=r" (percpu_value) : "i" (offsetof(percpu_t, field))); \
+        percpu_value; })
+
+#define this_cpu_write(field, value) \
+    asm volatile("movl %0, %%gs:%c1" : : "r" (value), "i" (offsetof(percpu_t, field)) : "memory")
+
+#define this_cpu_inc(field) \
+    asm volatile("incl %%gs:%c0" : : "i" (offsetof(percpu_t, field)) : "memory")
+
+/* Plain pointer to this CPU's block */
+#define this_cpu() this_cpu_read(self)
@@ -0,0 +1,24 @@
+; Kernel thread context switch, see kernel/thread.c
+[bits 32]
+
+section .text
+
+; void switch_context(uint32_t *old_esp, uint32_t new_esp)
+; Save the callee-saved registers on the current stack, store its pointer
+; in *old_esp, then continue on 'new_esp' where the same four registers
+; and a return address are waiting.
+global switch_context
+switch_context:
+    mov eax, [esp + 4] ; old_esp
+    mov edx, [esp + 8] ; new_esp
+    push ebp
+    push ebx
+    push esi
+    push edi
+    mov [eax], esp
+    mov esp, edx
+    pop edi
+    pop esi
+    pop ebx
+    pop ebp
+    ret
@@ -0,0 +1,92 @@
+; Entering and leaving ring 3, and the sysenter fast path. See syscall.c
+[bits 32]
+[extern syscall_dispatch]
+
+KERNEL_DS equ 0x10 ; Must match gdt.h
+PERCPU_SELECTOR equ 0x30
+USER_CS equ 0x1B
+USER_DS equ 0x23
+
+section .text
+
+; uint32_t enter_user_mode(uint32_t entry, uint32_t user_stack)
+; Runs 'entry' in ring 3 until it makes the exit system call, whose
+; argument becomes our return value.
+global enter_user_mode
+enter_user_mode:
+    ; 1. Save the callee-saved registers, user_mode_exit restores them
+    push ebp
+    push ebx
+    push esi
+    push edi
+    pushf
+    mov [user_mode_kernel_esp], esp
+    mov eax, [esp + 24] ; entry
+    mov ecx, [esp + 28] ; user_stack
+
+    ; 2. User data segments
+    mov dx, USER_DS
+    mov ds, dx
+    mov es, dx
+    mov fs, dx
+    mov gs, dx
+
+    ; 3. Fake the frame of an interrupt that came from ring 3 and return to it
+    push dword USER_DS ; ss
+    push ecx ; esp
+    push dword 0x202 ; eflags, interrupts enabled
+    push dword USER_CS ; cs
+    push eax ; eip
+    iret
+
+; void user_mode_exit(uint32_t code)
+; Called by the exit system call: drop whatever kernel stack the system
+; call came in on and return from enter_user_mode with 'code'.
+global user_mode_exit
+user_mode_exit:
+    mov eax, [esp + 4]
+    mov cx, KERNEL_DS
+    mov ds, cx
+    mov es, cx
+    mov fs, cx
+    mov cx, PERCPU_SELECTOR
+    mov gs, cx
+    mov esp, [user_mode_kernel_esp]
+    popf
+    pop edi
+    pop esi
+    pop ebx
+    pop ebp
+    ret
+
+; sysenter lands here with cs/ss/esp/eip loaded from the SYSENTER MSRs and
+; interrupts disabled. The caller passes the system call number in eax, the
+; arguments in ebx, esi and edi, its esp in ecx and the return eip in edx.
+global sysenter_entry
+sysenter_entry:
+    push ecx ; user esp
+    push edx ; user eip
+    mov cx, KERNEL_DS
+    mov ds, cx
+    mov es, cx
+    mov cx, PERCPU_SELECTOR
+    mov gs, cx
+
+    push edi
+    push esi
+    push ebx
+    push eax
+    call syscall_dispatch ; the result stays in eax
+    add esp, 16
+
+    mov cx, USER_DS
+    mov ds, cx
+    mov es, cx
+    mov gs, cx
+    pop edx
+    pop ecx
+    sti ; takes effect after sysexit
+    sysexit
+
+section .bss
+user_mode_kernel_esp: resd 1
@@ -0,0 +1,165 @@
+#include "syscall.h"
+#include "cpuid.h"
+#include "gdt.h"
+#include "idt.h"
+#include "isr.h"
+#include "paging.h"
+#include "percpu.h"
+#include "timer.h"
+#include "../drivers/display.h"
+#include "../kernel/util.h"
+
+#define MSR_SYSENTER_CS 0x174
+#define MSR_SYSENTER_ESP 0x175
+#define MSR_SYSENTER_EIP 0x176
+
+#define SYSCALL_STACK_SIZE 4096
+
+extern void sysenter_entry();
+
+typedef uint32_t (*syscall_t)(uint32_t arg1, uint32_t arg2, uint32_t arg3);
+
+/* Kernel stack for system calls and interrupts arriving from ring 3 */
+static uint8_t syscall_stack[SYSCALL_STACK_SIZE] __attribute__((aligned(16)));
+static bool sysenter_enabled = false;
+
+static uint32_t sys_exit(uint32_t code, uint32_t unused1, uint32_t unused2) {
+    user_mode_exit(code);
+    return 0; /* not reached */
+}
+
+/* Every byte up to the terminator must belong to the program; pages that
+ * aren't there yet are faulted in like on a user access */
+static uint32_t sys_write(uint32_t string, uint32_t unused1, uint32_t unused2) {
+    for (uint32_t address = string;; address++) {
+        if (!user_address_ok(address)) {
+            return (uint32_t) -1;
+        }
+        if (*(char *) address == '\0') {
+            break;
+        }
+    }
+    print_string((char *) string);
+    return 0;
+}
+
+static uint32_t sys_get_tick(uint32_t unused1, uint32_t unused2, uint32_t unused3) {
+    return get_tick();
+}
+
+static uint32_t sys_nop(uint32_t unused1, uint32_t unused2, uint32_t unused3) {
+    return 0;
+}
+
+static syscall_t syscall_table[SYSCALL_COUNT] = {
+        [SYS_EXIT] = sys_exit,
+        [SYS_WRITE] = sys_write,
+        [SYS_GET_TICK] = sys_get_tick,
+        [SYS_NOP] = sys_nop,
+};
+
+/* Common to both entry paths */
+uint32_t syscall_dispatch(uint32_t number, uint32_t arg1, uint32_t arg2, uint32_t arg3) {
+    this_cpu_inc(syscalls);
+    if (number >= SYSCALL_COUNT) {
+        return (uint32_t) -1;
+    }
+    return syscall_table[number](arg1, arg2, arg3);
+}
+
+/* int 0x80 */
+static bool syscall_handler(registers_t *r) {
+    r->eax = syscall_dispatch(r->eax, r->ebx, r->esi, r->edi);
+    return IRQ_HANDLED;
+}
+
+static void write_msr(uint32_t msr, uint32_t value) {
+    asm volatile("wrmsr" : : "c" (msr), "a" (value), "d" (0));
+}
+
+void init_syscalls() {
+    uint32_t stack_top = (uint32_t) syscall_stack + SYSCALL_STACK_SIZE;
+    tss_set_kernel_stack(stack_top);
+
+    set_user_idt_gate(SYSCALL_VECTOR, (uint32_t) isr128);
+    register_interrupt_handler(SYSCALL_VECTOR, syscall_handler);
+
+    if (cpuid_features_edx() & CPUID_EDX_SEP) {
+        write_msr(MSR_SYSENTER_CS, KERNEL_CS);
+        write_msr(MSR_SYSENTER_ESP, stack_top);
+        write_msr(MSR_SYSENTER_EIP, (uint32_t) sysenter_entry);
+        sysenter_enabled = true;
+    }
+}
+
+/*
+ * Round-trip benchmark. The ring 3 half only uses inline assembly, so it
+ * never calls into kernel-only code.
+ */
+#define SYSCALL_BENCH_ITERATIONS 10000
+
+#define user_syscall_int80(number, arg) ({ \
+    uint32_t result; \
+    asm volatile("int $0x80" : "=a" (result) : "a" (number), "b" (arg) : "memory"); \
+    result; \
+})
+
+#define user_syscall_sysenter(number, arg) ({ \
+    uint32_t result; \
+    asm volatile("mov %%esp, %%ecx\n" \
+                 "movl $1f, %%edx\n" \
+                 "sysenter\n" \
+                 "1:" \
+                 : "=a" (result) : "a" (number), "b" (arg) : "ecx", "edx", "memory"); \
+    result; \
+})
+
+#define user_rdtsc_low() ({ \
+    uint32_t low, high; \
+    asm volatile("rdtsc" : "=a" (low), "=d" (high)); \
+    low; \
+})
+
+static USER_DATA uint8_t bench_user_stack[1024] __attribute__((aligned(16)));
+static USER_DATA uint32_t bench_use_sysenter;
+static USER_DATA uint32_t bench_int80_cycles;
+static USER_DATA uint32_t bench_sysenter_cycles;
+
+static USER_TEXT void syscall_benchmark_user() {
+    uint32_t start = user_rdtsc_low();
+    for (int i = 0; i < SYSCALL_BENCH_ITERATIONS; i++) {
+        user_syscall_int80(SYS_NOP, 0);
+    }
+    bench_int80_cycles = (user_rdtsc_low() - start) / SYSCALL_BENCH_ITERATIONS;
+
+    if (bench_use_sysenter) {
+        start = user_rdtsc_low();
+        for (int i = 0; i < SYSCALL_BENCH_ITERATIONS; i++) {
+            user_syscall_sysenter(SYS_NOP, 0);
+        }
+        bench_sysenter_cycles = (user_rdtsc_low() - start) / SYSCALL_BENCH_ITERATIONS;
+    }
+
+    user_syscall_int80(SYS_EXIT, 0);
+}
+
+void run_syscall_benchmark() {
+    bench_use_sysenter = sysenter_enabled;
+    enter_user_mode((uint32_t) syscall_benchmark_user,
+                    (uint32_t) bench_user_stack + sizeof(bench_user_stack));
+
+    char cycles[16];
+    int_to_string(bench_int80_cycles, cycles);
+    print_string("int 0x80 round trip: ");
+    print_string(cycles);
+    print_string(" cycles\n");
+
+    print_string("sysenter/sysexit round trip: ");
+    if (sysenter_enabled) {
+        int_to_string(bench_sysenter_cycles, cycles);
+        print_string(cycles);
+        print_string(" cycles\n");
+    } else {
+        print_string("not supported by this CPU\n");
+    }
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <stdint.h>
+
+#define SYSCALL_VECTOR 0x80
+
+/* System call numbers.
+ * eax holds the number, ebx, esi and edi the arguments, the result comes
+ * back in eax. Both 'int 0x80' and 'sysenter' use this convention, which is
+ * why ecx and edx are left out: sysenter needs them for the return path. */
+#define SYS_EXIT 0
+#define SYS_WRITE 1
+#define SYS_GET_TICK 2
+#define SYS_NOP 3
+#define SYSCALL_COUNT 4
+
+/* Kernel code and data that ring 3 is allowed to run and touch,
+ * kept together by linker.ld between __user_start and __user_end */
+#define USER_TEXT __attribute__((section(".user_text")))
+#define USER_DATA __attribute__((section(".user_data")))
+
+void init_syscalls();
+
+uint32_t syscall_dispatch(uint32_t number, uint32_t arg1, uint32_t arg2, uint32_t arg3);
+
+/* Implemented in syscall.asm */
+uint32_t enter_user_mode(uint32_t entry, uint32_t user_stack);
+
+void user_mode_exit(uint32_t code);
+
+/* Measure a ring 3 -> ring 0 -> ring 3 round trip through each path */
+void run_syscall_benchmark();
@@ -2,18 +2,100 @@
 #include "../drivers/display.h"
 #include "../drivers/ports.h"
 #include "../kernel/util.h"
+#include "../kernel/mem.h"
 #include "isr.h"
+#include "percpu.h"
 
-uint32_t tick = 0;
+/*
+ * Hierarchical timing wheel.
+ * Level 0 has one slot per tick for the next 64 ticks, level 1 one slot per
+ * 64 ticks for the next 4096 and so on. Adding and cancelling only touch a
+ * single list. Each tick expires the current level 0 slot; every 64 ticks
+ * the next slot of the level above is cascaded down into the finer levels.
+ */
+#define WHEEL_BITS 6
+#define WHEEL_SIZE (1 << WHEEL_BITS)
+#define WHEEL_MASK (WHEEL_SIZE - 1)
+#define WHEEL_LEVELS 4
+#define WHEEL_MAX_DELTA ((1 << (WHEEL_BITS * WHEEL_LEVELS)) - 1)
 
-static void timer_callback(registers_t *regs) {
-    tick++;
-    print_string("Tick: ");
+static timer_t *wheel[WHEEL_LEVELS][WHEEL_SIZE];
+static uint32_t wheel_tick = 0; /* next tick whose slot has not been expired yet */
 
-    char tick_ascii[256];
-    int_to_string(tick, tick_ascii);
-    print_string(tick_ascii);
-    print_nl();
+static void wheel_insert(timer_t *timer) {
+    uint32_t expires = timer->expires;
+    int32_t delta = (int32_t) (expires - wheel_tick);
+
+    if (delta < 0) {
+        // already due, expire on the next tick
+        expires = wheel_tick;
+        delta = 0;
+    } else if (delta > WHEEL_MAX_DELTA) {
+        // too far away: park it in the last slot, it gets re-cascaded from there
+        expires = wheel_tick + WHEEL_MAX_DELTA;
+        delta = WHEEL_MAX_DELTA;
+    }
+
+    int level = 0;
+    while (delta >= (1 << (WHEEL_BITS * (level + 1)))) {
+        level++;
+    }
+
+    timer_t **slot = &wheel[level][(expires >> (WHEEL_BITS * level)) & WHEEL_MASK];
+    timer->next = *slot;
+    if (timer->next != NULL_POINTER) {
+        timer->next->pprev = &timer->next;
+    }
+    timer->pprev = slot;
+    *slot = timer;
+}
+
+static void wheel_remove(timer_t *timer) {
+    *timer->pprev = timer->next;
+    if (timer->next != NULL_POINTER) {
+        timer->next->pprev = timer->pprev;
+    }
+    timer->next = NULL_POINTER;
+    timer->pprev = NULL_POINTER;
+}
+
+/* Move all timers of one slot of 'level' down to the finer levels.
+ * Returns the slot index, so the caller knows whether this level wrapped. */
+static int cascade(int level) {
+    int index = (wheel_tick >> (WHEEL_BITS * level)) & WHEEL_MASK;
+    timer_t *timer;
+    while ((timer = wheel[level][index]) != NULL_POINTER) {
+        wheel_remove(timer);
+        wheel_insert(timer);
+    }
+    return index;
+}
+
+static bool timer_callback(registers_t *regs) {
+    this_cpu_inc(tick);
+    uint32_t tick = this_cpu_read(tick);
+
+    while ((int32_t) (tick - wheel_tick) >= 0) {
+        int index = wheel_tick & WHEEL_MASK;
+        if (index == 0) {
+            for (int level = 1; level < WHEEL_LEVELS && cascade(level) == 0; level++);
+        }
+        wheel_tick++;
+
+        /* Detach the slot first: a callback re-arming 64 ticks ahead lands
+         * in this very slot, for the next lap */
+        timer_t *expired = wheel[0][index];
+        wheel[0][index] = NULL_POINTER;
+        if (expired != NULL_POINTER) {
+            expired->pprev = &expired;
+        }
+        timer_t *timer;
+        while ((timer = expired) != NULL_POINTER) {
+            wheel_remove(timer);
+            timer->callback(timer->data);
+        }
+    }
+    return IRQ_HANDLED;
 }
 
 void init_timer(uint32_t freq) {
@@ -28,4 +110,37 @@ void init_timer(uint32_t freq) {
     port_byte_out(0x43, 0x36); /* Command port */
     port_byte_out(0x40, low);
     port_byte_out(0x40, high);
-}
\ No newline at end of file
+}
+
+uint32_t get_tick() {
+    return this_cpu_read(tick);
+}
+
+void timer_setup(timer_t *timer, timer_callback_t callback, void *data) {
+    timer->callback = callback;
+    timer->data = data;
+    timer->next = NULL_POINTER;
+    timer->pprev = NULL_POINTER;
+}
+
+void timer_add(timer_t *timer, uint32_t expires) {
+    uint32_t flags = irq_save();
+    if (timer->pprev != NULL_POINTER) {
+        wheel_remove(timer);
+    }
+    timer->expires = expires;
+    wheel_insert(timer);
+    irq_restore(flags);
+}
+
+void timer_cancel(timer_t *timer) {
+    uint32_t flags = irq_save();
+    if (timer->pprev != NULL_POINTER) {
+        wheel_remove(timer);
+    }
+    irq_restore(flags);
+}
+
+bool timer_pending(timer_t *timer) {
+    return timer->pprev != NULL_POINTER;
+}
@@ -2,4 +2,29 @@
 
 #include "../kernel/util.h"
 
-void init_timer(uint32_t freq);
\ No newline at end of file
+#define TIMER_FREQUENCY 100 /* ticks per second */
+
+typedef void (*timer_callback_t)(void *data);
+
+/* A one-shot kernel timer. Embed it in the owning structure, set it up once
+ * with timer_setup, then arm it with timer_add as often as needed. */
+typedef struct timer {
+    uint32_t expires; /* tick at which the callback runs */
+    timer_callback_t callback; /* called from the IRQ0 handler */
+    void *data;
+    struct timer *next;
+    struct timer **pprev; /* the pointer pointing at us, NULL when not pending */
+} timer_t;
+
+void init_timer(uint32_t freq);
+
+uint32_t get_tick();
+
+void timer_setup(timer_t *timer, timer_callback_t callback, void *data);
+
+/* Run the callback once 'expires' is reached. Re-adding a pending timer moves it. */
+void timer_add(timer_t *timer, uint32_t expires);
+
+void timer_cancel(timer_t *timer);
+
+bool timer_pending(timer_t *timer);
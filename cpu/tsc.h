@@ -0,0 +1,10 @@
+#pragma once
+
+#include <stdint.h>
+
+/* Cycles since reset, read from the time stamp counter */
+static inline uint64_t rdtsc() {
+    uint32_t low, high;
+    asm volatile("rdtsc" : "=a" (low), "=d" (high));
+    return ((uint64_t) high << 32) | low;
+}
@@ -0,0 +1,165 @@
+#include "ata.h"
+#include "block.h"
+#include "display.h"
+#include "ports.h"
+#include "../cpu/isr.h"
+#include "../kernel/mem.h"
+#include "../kernel/util.h"
+
+// https://wiki.osdev.org/ATA_PIO_Mode
+
+#define ATA_IO 0x1F0 /* primary channel */
+#define ATA_DATA (ATA_IO + 0)
+#define ATA_ERROR (ATA_IO + 1)
+#define ATA_SECTOR_COUNT (ATA_IO + 2)
+#define ATA_LBA_LOW (ATA_IO + 3)
+#define ATA_LBA_MID (ATA_IO + 4)
+#define ATA_LBA_HIGH (ATA_IO + 5)
+#define ATA_DRIVE (ATA_IO + 6)
+#define ATA_STATUS (ATA_IO + 7) /* reading it acknowledges the interrupt */
+#define ATA_COMMAND (ATA_IO + 7)
+
+#define ATA_STATUS_ERR 0x01
+#define ATA_STATUS_DRQ 0x08
+#define ATA_STATUS_DF 0x20
+#define ATA_STATUS_BSY 0x80
+
+#define ATA_CMD_READ_SECTORS 0x20
+#define ATA_CMD_WRITE_SECTORS 0x30
+#define ATA_CMD_IDENTIFY 0xEC
+
+#define ATA_DRIVE_MASTER_LBA 0xE0
+#define ATA_MAX_SECTORS 128 /* per command, fits the 8 bit sector count */
+#define ATA_POLL_LIMIT 100000
+
+static void ata_start(block_device_t *device, block_request_t *request);
+
+static block_device_t ata_device = {
+        .name = "hda",
+        .max_sectors = ATA_MAX_SECTORS,
+        .start = ata_start,
+};
+
+/* Where the running command is in the chain of merged requests */
+static block_request_t *transfer_request;
+static uint32_t transfer_sector;
+static uint32_t sectors_left;
+
+/* Only used while setting up a command, the data itself arrives by IRQ */
+static uint8_t ata_poll(uint8_t mask, uint8_t value) {
+    uint8_t status = 0;
+    for (int i = 0; i < ATA_POLL_LIMIT; i++) {
+        status = port_byte_in(ATA_STATUS);
+        if ((status & mask) == value || (status & ATA_STATUS_ERR)) {
+            break;
+        }
+    }
+    return status;
+}
+
+/* Move one sector between the data port and the buffer of the request it belongs to */
+static void transfer_sector_data(uint8_t op) {
+    uint16_t *buffer = (uint16_t *) (transfer_request->buffer + transfer_sector * SECTOR_SIZE);
+    if (op == BLOCK_READ) {
+        port_words_in(ATA_DATA, buffer, SECTOR_SIZE / 2);
+    } else {
+        port_words_out(ATA_DATA, buffer, SECTOR_SIZE / 2);
+    }
+    sectors_left--;
+    if (++transfer_sector == transfer_request->count) {
+        transfer_request = transfer_request->chain;
+        transfer_sector = 0;
+    }
+}
+
+static void ata_start(block_device_t *device, block_request_t *request) {
+    transfer_request = request;
+    transfer_sector = 0;
+    sectors_left = request->chain_count;
+
+    ata_poll(ATA_STATUS_BSY, 0);
+    port_byte_out(ATA_DRIVE, ATA_DRIVE_MASTER_LBA | ((request->sector >> 24) & 0x0F));
+    port_byte_out(ATA_SECTOR_COUNT, request->chain_count);
+    port_byte_out(ATA_LBA_LOW, request->sector);
+    port_byte_out(ATA_LBA_MID, request->sector >> 8);
+    port_byte_out(ATA_LBA_HIGH, request->sector >> 16);
+    port_byte_out(ATA_COMMAND, request->op == BLOCK_READ ? ATA_CMD_READ_SECTORS : ATA_CMD_WRITE_SECTORS);
+
+    if (request->op == BLOCK_WRITE) {
+        /* The first sector is requested without an interrupt */
+        uint8_t status = ata_poll(ATA_STATUS_BSY | ATA_STATUS_DRQ, ATA_STATUS_DRQ);
+        if (status & (ATA_STATUS_ERR | ATA_STATUS_DF)) {
+            block_complete(device, request, BLOCK_ERROR);
+            return;
+        }
+        transfer_sector_data(BLOCK_WRITE);
+    }
+}
+
+/* Reads raise an IRQ per sector once it is ready, writes per sector written */
+static bool ata_callback(registers_t *regs) {
+    uint8_t status = port_byte_in(ATA_STATUS);
+    block_request_t *request = ata_device.active;
+    if (request == NULL_POINTER) {
+        return IRQ_NONE; /* not ours, or left over from IDENTIFY */
+    }
+    if (status & (ATA_STATUS_ERR | ATA_STATUS_DF)) {
+        block_complete(&ata_device, request, BLOCK_ERROR);
+        return IRQ_HANDLED;
+    }
+
+    if (request->op == BLOCK_READ) {
+        transfer_sector_data(BLOCK_READ);
+    } else if (sectors_left > 0) {
+        transfer_sector_data(BLOCK_WRITE);
+        return IRQ_HANDLED;
+    }
+    if (sectors_left == 0) {
+        block_complete(&ata_device, request, BLOCK_OK);
+    }
+    return IRQ_HANDLED;
+}
+
+/* Returns the number of LBA28 sectors, 0 if there is no ATA disk */
+static uint32_t ata_identify() {
+    port_byte_out(ATA_DRIVE, 0xA0);
+    port_byte_out(ATA_SECTOR_COUNT, 0);
+    port_byte_out(ATA_LBA_LOW, 0);
+    port_byte_out(ATA_LBA_MID, 0);
+    port_byte_out(ATA_LBA_HIGH, 0);
+    port_byte_out(ATA_COMMAND, ATA_CMD_IDENTIFY);
+
+    uint8_t status = port_byte_in(ATA_STATUS);
+    if (status == 0 || status == 0xFF) {
+        return 0; /* no drive, or floating bus */
+    }
+    status = ata_poll(ATA_STATUS_BSY, 0);
+    if (port_byte_in(ATA_LBA_MID) != 0 || port_byte_in(ATA_LBA_HIGH) != 0) {
+        return 0; /* ATAPI or SATA */
+    }
+    status = ata_poll(ATA_STATUS_DRQ, ATA_STATUS_DRQ);
+    if (status & (ATA_STATUS_ERR | ATA_STATUS_BSY) || !(status & ATA_STATUS_DRQ)) {
+        return 0;
+    }
+
+    uint16_t identify[256];
+    port_words_in(ATA_DATA, identify, 256);
+    return identify[60] | ((uint32_t) identify[61] << 16);
+}
+
+void init_ata() {
+    register_interrupt_handler(IRQ14, ata_callback);
+
+    ata_device.sector_count = ata_identify();
+    if (ata_device.sector_count == 0) {
+        print_string("No ATA disk found.\n");
+        return;
+    }
+    block_register(&ata_device);
+
+    char size_ascii[12];
+    int_to_string(ata_device.sector_count / 2, size_ascii);
+    print_string("ATA disk hda, ");
+    print_string(size_ascii);
+    print_string(" KiB.\n");
+}
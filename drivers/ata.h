@@ -0,0 +1,4 @@
+#pragma once
+
+/* Primary ATA master in PIO mode, completing requests from IRQ 14 */
+void init_ata();
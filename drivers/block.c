@@ -0,0 +1,296 @@
+#include "block.h"
+#include "display.h"
+#include "../cpu/isr.h"
+#include "../kernel/mem.h"
+#include "../kernel/util.h"
+
+static block_device_t *devices[MAX_BLOCK_DEVICES];
+static int device_count = 0;
+
+void block_register(block_device_t *device) {
+    wait_queue_init(&device->wait);
+    if (device->max_active == 0) {
+        device->max_active = 1;
+    }
+    if (device_count < MAX_BLOCK_DEVICES) {
+        devices[device_count++] = device;
+    }
+}
+
+block_device_t *block_get_device(int index) {
+    return index < device_count ? devices[index] : NULL_POINTER;
+}
+
+static uint32_t request_end(block_request_t *request) {
+    return request->sector + request->chain_count;
+}
+
+/* Keep the queue sorted by sector for the elevator */
+static void insert_sorted(block_device_t *device, block_request_t *request) {
+    block_request_t **link = &device->queue;
+    while (*link != NULL_POINTER && (*link)->sector <= request->sector) {
+        link = &(*link)->next;
+    }
+    request->next = *link;
+    *link = request;
+}
+
+/* Join the request queued right behind 'request' onto its chain if the two
+ * touch, so merging one request can close the gap between two others */
+static void merge_with_next(block_device_t *device, block_request_t *request) {
+    block_request_t *next = request->next;
+    if (next == NULL_POINTER || next->op != request->op || request_end(request) != next->sector
+        || request->chain_count + next->chain_count > device->max_sectors) {
+        return;
+    }
+    request->next = next->next;
+    request->chain_tail->chain = next;
+    request->chain_tail = next->chain_tail;
+    request->chain_count += next->chain_count;
+}
+
+/* Turn 'request' and a queued request it is adjacent to into a single
+ * command: appended when it starts where the queued one ends, put in front
+ * when it ends where the queued one starts. The result is then tried
+ * against its new neighbour. */
+static bool merge_request(block_device_t *device, block_request_t *request) {
+    for (block_request_t **link = &device->queue; *link != NULL_POINTER; link = &(*link)->next) {
+        block_request_t *queued = *link;
+        if (queued->op != request->op || queued->chain_count + request->count > device->max_sectors) {
+            continue;
+        }
+        if (request_end(queued) == request->sector) {
+            queued->chain_tail->chain = request;
+            queued->chain_tail = request;
+            queued->chain_count += request->count;
+            merge_with_next(device, queued);
+            return true;
+        }
+        if (request->sector + request->count == queued->sector) {
+            *link = queued->next;
+            request->chain = queued;
+            request->chain_tail = queued->chain_tail;
+            request->chain_count += queued->chain_count;
+            insert_sorted(device, request);
+            for (block_request_t *previous = device->queue; previous != NULL_POINTER; previous = previous->next) {
+                if (previous->next == request) {
+                    merge_with_next(device, previous);
+                    break;
+                }
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+/* Start queued requests while the hardware has room for them. One-way
+ * elevator: continue upwards from where the last request ended, wrapping to
+ * the lowest sector. The driver is kicked once for everything started. */
+static void dispatch(block_device_t *device) {
+    if (device->plugged) {
+        return;
+    }
+    bool started = false;
+    while (device->active_count < device->max_active && device->queue != NULL_POINTER) {
+        block_request_t **link = &device->queue;
+        while (*link != NULL_POINTER && (*link)->sector < device->head_sector) {
+            link = &(*link)->next;
+        }
+        if (*link == NULL_POINTER) {
+            link = &device->queue;
+        }
+        block_request_t *request = *link;
+        *link = request->next;
+
+        request->next = device->active;
+        device->active = request;
+        device->active_count++;
+        device->head_sector = request_end(request);
+        device->stats.dispatched++;
+        device->start(device, request);
+        started = true;
+    }
+    if (started && device->kick != NULL_POINTER) {
+        device->stats.kicks++;
+        device->kick(device);
+    }
+}
+
+static void finish_request(block_device_t *device, block_request_t *request, int status) {
+    if (status == BLOCK_OK) {
+        device->stats.completed++;
+    } else {
+        device->stats.errors++;
+    }
+    request->status = status;
+    if (request->callback != NULL_POINTER) {
+        request->callback(request);
+    }
+}
+
+void block_submit(block_device_t *device, block_request_t *request) {
+    request->status = BLOCK_PENDING;
+    request->next = NULL_POINTER;
+    request->chain = NULL_POINTER;
+    request->chain_tail = request;
+    request->chain_count = request->count;
+
+    uint32_t flags = irq_save();
+    device->stats.submitted++;
+    if (request->count == 0 || request->count > device->max_sectors
+        || request->sector + request->count > device->sector_count) {
+        finish_request(device, request, BLOCK_ERROR);
+    } else if (merge_request(device, request)) {
+        device->stats.merged++;
+    } else {
+        insert_sorted(device, request);
+    }
+    dispatch(device);
+    irq_restore(flags);
+}
+
+void block_plug(block_device_t *device) {
+    uint32_t flags = irq_save();
+    device->plugged++;
+    irq_restore(flags);
+}
+
+void block_unplug(block_device_t *device) {
+    uint32_t flags = irq_save();
+    if (--device->plugged == 0) {
+        dispatch(device);
+    }
+    irq_restore(flags);
+}
+
+void block_complete(block_device_t *device, block_request_t *request, int status) {
+    block_request_t **link = &device->active;
+    while (*link != request) {
+        link = &(*link)->next;
+    }
+    *link = request->next;
+    request->next = NULL_POINTER;
+    device->active_count--;
+    if (status == BLOCK_OK) {
+        device->stats.sectors += request->chain_count;
+    }
+
+    /* Keep the hardware busy while the callbacks run */
+    dispatch(device);
+
+    while (request != NULL_POINTER) {
+        block_request_t *next = request->chain; /* the request may be reused once finished */
+        finish_request(device, request, status);
+        request = next;
+    }
+    wake_up(&device->wait);
+}
+
+int block_wait(block_device_t *device, block_request_t *request) {
+    block_submit(device, request);
+    wait_event(&device->wait, request->status != BLOCK_PENDING);
+    return request->status;
+}
+
+void print_block_stats() {
+    if (device_count == 0) {
+        print_string("No block devices.\n");
+        return;
+    }
+    for (int i = 0; i < device_count; i++) {
+        block_stats_t *stats = &devices[i]->stats;
+        print_string(devices[i]->name);
+        print_string(": ");
+        print_number(devices[i]->sector_count);
+        print_string(" sectors, ");
+        print_number(stats->submitted);
+        print_string(" submitted, ");
+        print_number(stats->merged);
+        print_string(" merged, ");
+        print_number(stats->dispatched);
+        print_string(" commands, ");
+        print_number(stats->kicks);
+        print_string(" kicks, ");
+        print_number(stats->completed);
+        print_string(" completed, ");
+        print_number(stats->errors);
+        print_string(" errors, ");
+        print_number(stats->sectors);
+        print_string(" sectors transferred\n");
+    }
+}
+
+#define TEST_SECTORS (BLOCK_TEST_BYTES / SECTOR_SIZE)
+
+static uint8_t *test_buffer; /* the caller's, while a test runs */
+static block_request_t test_requests[TEST_SECTORS];
+static volatile int test_completed;
+/* The state above is shared, one test at a time */
+static bool test_running = false;
+static wait_queue_t test_wait;
+
+static void count_completion(block_request_t *request) {
+    test_completed++;
+}
+
+
+static void submit_test_request(block_device_t *device, int index, uint8_t op, uint32_t first, uint32_t count) {
+    block_request_t *request = &test_requests[index];
+    request->op = op;
+    request->sector = device->sector_count - TEST_SECTORS + first;
+    request->count = count;
+    request->buffer = test_buffer + first * SECTOR_SIZE;
+    request->callback = count_completion;
+    block_submit(device, request);
+}
+
+/* Write the last sectors of the disk one at a time in shuffled order, so the
+ * queue has something to sort and merge, then read them back in two halves.
+ * Both rounds are plugged and must each reach the driver as one command. */
+void run_block_test(block_device_t *device, uint8_t *buffer) {
+    static const uint8_t write_order[TEST_SECTORS] = {3, 1, 0, 2, 7, 5, 4, 6};
+
+    /* Threads are cooperative, nobody else runs between the check and the claim */
+    wait_event(&test_wait, !test_running);
+    test_running = true;
+    test_buffer = buffer;
+
+    for (int i = 0; i < BLOCK_TEST_BYTES; i++) {
+        test_buffer[i] = i / SECTOR_SIZE + i;
+    }
+    uint32_t dispatched = device->stats.dispatched;
+    test_completed = 0;
+    block_plug(device);
+    for (int i = 0; i < TEST_SECTORS; i++) {
+        submit_test_request(device, i, BLOCK_WRITE, write_order[i], 1);
+    }
+    block_unplug(device);
+    wait_event(&device->wait, test_completed == TEST_SECTORS);
+
+    for (int i = 0; i < BLOCK_TEST_BYTES; i++) {
+        test_buffer[i] = 0;
+    }
+    test_completed = 0;
+    block_plug(device);
+    submit_test_request(device, 0, BLOCK_READ, TEST_SECTORS / 2, TEST_SECTORS / 2);
+    submit_test_request(device, 1, BLOCK_READ, 0, TEST_SECTORS / 2);
+    block_unplug(device);
+    wait_event(&device->wait, test_completed == 2);
+
+    bool passed = true;
+    for (int i = 0; i < TEST_SECTORS; i++) {
+        passed &= test_requests[i].status == BLOCK_OK;
+    }
+    for (int i = 0; i < BLOCK_TEST_BYTES; i++) {
+        passed &= test_buffer[i] == (uint8_t) (i / SECTOR_SIZE + i);
+    }
+    if (device->stats.dispatched - dispatched != 2) {
+        print_string("Disk test: requests were not merged into one command per batch.\n");
+        passed = false;
+    }
+    print_string(passed ? "Disk test passed.\n" : "Disk test FAILED.\n");
+
+    test_running = false;
+    wake_up(&test_wait);
+}
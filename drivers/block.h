@@ -0,0 +1,100 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "../kernel/thread.h"
+
+#define SECTOR_SIZE 512
+
+#define BLOCK_READ 0
+#define BLOCK_WRITE 1
+
+/* Request status */
+#define BLOCK_PENDING 1
+#define BLOCK_OK 0
+#define BLOCK_ERROR (-1)
+
+struct block_request;
+
+/* Called from the completing IRQ handler, keep it short */
+typedef void (*block_callback_t)(struct block_request *request);
+
+/* A read or write of consecutive sectors. The caller owns the request and
+ * must keep it (and the buffer) alive until the callback has run. */
+typedef struct block_request {
+    uint8_t op;
+    uint32_t sector;
+    uint32_t count;
+    uint8_t *buffer;
+    volatile int status;
+    block_callback_t callback; /* may be NULL */
+    void *data; /* for the callback */
+
+    /* Owned by the block layer */
+    struct block_request *next; /* in the device queue sorted by sector, then in the active list */
+    struct block_request *chain; /* requests merged behind this one */
+    struct block_request *chain_tail;
+    uint32_t chain_count; /* sectors of this request and its chain */
+} block_request_t;
+
+typedef struct {
+    uint32_t submitted;
+    uint32_t merged; /* submitted requests that rode along with another one */
+    uint32_t dispatched; /* commands sent to the hardware */
+    uint32_t kicks; /* batches of commands the driver was told about */
+    uint32_t completed;
+    uint32_t errors;
+    uint32_t sectors;
+} block_stats_t;
+
+typedef struct block_device {
+    char *name;
+    uint32_t sector_count;
+    uint32_t max_sectors; /* per hardware command, merging stops there */
+    uint32_t max_active; /* commands the hardware takes at once, 0 means 1 */
+    /* Start the transfer of 'request' and its chain, then return.
+     * The driver calls block_complete once the hardware is done. */
+    void (*start)(struct block_device *device, block_request_t *request);
+    /* Optional: called once after a batch of start calls, for drivers that
+     * tell the hardware about new commands separately */
+    void (*kick)(struct block_device *device);
+    void *driver_data;
+
+    block_request_t *queue;
+    block_request_t *active; /* commands at the hardware, most recent first */
+    uint32_t active_count;
+    uint32_t plugged; /* while non-zero requests are only queued */
+    uint32_t head_sector; /* where the last request ended, for the elevator */
+    wait_queue_t wait; /* woken up whenever requests complete */
+    block_stats_t stats;
+} block_device_t;
+
+#define MAX_BLOCK_DEVICES 4
+
+void block_register(block_device_t *device);
+
+block_device_t *block_get_device(int index);
+
+/* Queue a request; returns immediately, completion is signalled through the
+ * callback and the status field. */
+void block_submit(block_device_t *device, block_request_t *request);
+
+/* Hold back dispatching so that requests submitted in between are sorted,
+ * merged and handed to the driver as one batch by block_unplug. Nests. */
+void block_plug(block_device_t *device);
+void block_unplug(block_device_t *device);
+
+/* For drivers: the active 'request' finished with 'status' */
+void block_complete(block_device_t *device, block_request_t *request, int status);
+
+/* Submit and sleep until done, other threads run meanwhile.
+ * Returns BLOCK_OK or BLOCK_ERROR. */
+int block_wait(block_device_t *device, block_request_t *request);
+
+void print_block_stats();
+
+#define BLOCK_TEST_BYTES (8 * SECTOR_SIZE)
+
+/* Write and read back the last sectors of 'device', through 'buffer' of
+ * BLOCK_TEST_BYTES, which has to stay mapped at its address for DMA */
+void run_block_test(block_device_t *device, uint8_t *buffer);
@@ -2,21 +2,81 @@
 #include "ports.h"
 #include <stdint.h>
 #include "../kernel/util.h"
+#include "../cpu/isr.h"
 
-void set_cursor(int offset) {
-    offset /= 2;
-    port_byte_out(REG_SCREEN_CTRL, 14);
-    port_byte_out(REG_SCREEN_DATA, (unsigned char) (offset >> 8));
-    port_byte_out(REG_SCREEN_CTRL, 15);
-    port_byte_out(REG_SCREEN_DATA, (unsigned char) (offset & 0xff));
+/*
+ * Every virtual console owns CONSOLE_BUFFER_ROWS consecutive rows of video
+ * memory, and its screen is a window onto them. Scrolling moves the window
+ * down one row and lets the CRTC start address follow, instead of copying
+ * the whole screen up. Rows that scrolled out of the window stay in video
+ * memory and can be browsed as scrollback. Only when the window reaches the
+ * end of the console's rows is the tail copied back to the top.
+ *
+ * Switching consoles just points the CRTC at another console's window.
+ * Consoles in the background are written to in memory only and never touch
+ * the CRTC registers.
+ *
+ * Offsets passed around by the public API stay relative to the top-left
+ * corner of the screen, exactly as before.
+ */
+typedef struct {
+    int screen_row; /* row shown at the top of the screen */
+    int view_row; /* row displayed while active, < screen_row while browsing */
+    int cursor; /* offset of the cursor on the screen */
+} console_t;
+
+static console_t consoles[NUM_CONSOLES];
+static int active_console = 0; /* the one on the monitor and receiving keys */
+static int output_console = 0; /* the one print_string writes to */
+static int crtc_start_row = 0; /* what the CRTC start address is currently programmed to */
+
+static int console_base_row(console_t *console) {
+    return (console - consoles) * CONSOLE_BUFFER_ROWS;
 }
 
-int get_cursor() {
+static bool console_is_active(console_t *console) {
+    return console == &consoles[active_console];
+}
+
+static char *screen_address(console_t *console, int offset) {
+    return (char *) VIDEO_ADDRESS + (console_base_row(console) + console->screen_row) * 2 * MAX_COLS + offset;
+}
+
+static void set_start_row(int row) {
+    if (row == crtc_start_row) {
+        return;
+    }
+    int start = row * MAX_COLS;
+    port_byte_out(REG_SCREEN_CTRL, 12);
+    port_byte_out(REG_SCREEN_DATA, (unsigned char) (start >> 8));
+    port_byte_out(REG_SCREEN_CTRL, 13);
+    port_byte_out(REG_SCREEN_DATA, (unsigned char) (start & 0xff));
+    crtc_start_row = row;
+}
+
+static void update_hardware_cursor(console_t *console) {
+    int position = console->cursor / 2 + (console_base_row(console) + console->screen_row) * MAX_COLS;
     port_byte_out(REG_SCREEN_CTRL, 14);
-    int offset = port_byte_in(REG_SCREEN_DATA) << 8; /* High byte: << 8 */
+    port_byte_out(REG_SCREEN_DATA, (unsigned char) (position >> 8));
     port_byte_out(REG_SCREEN_CTRL, 15);
-    offset += port_byte_in(REG_SCREEN_DATA);
-    return offset * 2;
+    port_byte_out(REG_SCREEN_DATA, (unsigned char) (position & 0xff));
+}
+
+static void console_set_cursor(console_t *console, int offset) {
+    console->cursor = offset;
+    /* Any output brings us back from the scrollback */
+    console->view_row = console->screen_row;
+    if (console_is_active(console)) {
+        /* This is where a burst of scroll_ln calls reaches the CRTC, once */
+        set_start_row(console_base_row(console) + console->view_row);
+        update_hardware_cursor(console);
+    }
+}
+
+void set_cursor(int offset) {
+    uint32_t flags = irq_save();
+    console_set_cursor(&consoles[output_console], offset);
+    irq_restore(flags);
 }
 
 int get_offset(int col, int row) {
@@ -31,66 +91,170 @@ int move_offset_to_new_line(int offset) {
     return get_offset(0, get_row_from_offset(offset) + 1);
 }
 
+static void console_set_char(console_t *console, char character, int offset) {
+    char *vga = screen_address(console, offset);
+    vga[0] = character;
+    vga[1] = WHITE_ON_BLACK;
+}
+
 void set_char_at_video_memory(char character, int offset) {
-    char *vga = (char*) VIDEO_ADDRESS;
-    vga[offset] = character;
-    vga[offset + 1] = WHITE_ON_BLACK;
+    uint32_t flags = irq_save();
+    console_set_char(&consoles[output_console], character, offset);
+    irq_restore(flags);
 }
 
-int scroll_ln(int offset) {
+/* The window hit the end of the console's rows: keep the screen and the
+ * most recent SCROLLBACK_KEEP_ROWS rows, and move them to the top. */
+static void rebase_buffer(console_t *console) {
+    int keep = console->screen_row; /* rows above the screen are all scrollback */
+    if (keep > SCROLLBACK_KEEP_ROWS) {
+        keep = SCROLLBACK_KEEP_ROWS;
+    }
+    uint8_t *base = (uint8_t *) VIDEO_ADDRESS + console_base_row(console) * 2 * MAX_COLS;
     memory_copy(
-            (char * )(get_offset(0, 1) + VIDEO_ADDRESS),
-            (char * )(get_offset(0, 0) + VIDEO_ADDRESS),
-            MAX_COLS * (MAX_ROWS - 1) * 2
+            base + (console->screen_row - keep) * 2 * MAX_COLS,
+            base,
+            (keep + MAX_ROWS) * 2 * MAX_COLS
     );
+    console->screen_row = keep;
+}
+
+static int console_scroll_ln(console_t *console, int offset) {
+    if (console->screen_row + MAX_ROWS >= CONSOLE_BUFFER_ROWS) {
+        rebase_buffer(console);
+    }
+    console->screen_row++;
 
     for (int col = 0; col < MAX_COLS; col++) {
-        set_char_at_video_memory(' ', get_offset(col, MAX_ROWS - 1));
+        console_set_char(console, ' ', get_offset(col, MAX_ROWS - 1));
     }
 
     return offset - 2 * MAX_COLS;
 }
 
+int scroll_ln(int offset) {
+    uint32_t flags = irq_save();
+    offset = console_scroll_ln(&consoles[output_console], offset);
+    irq_restore(flags);
+    return offset;
+}
+
+void scroll_view(int rows) {
+    uint32_t flags = irq_save();
+    console_t *console = &consoles[active_console];
+    int row = console->view_row + rows;
+    if (row < 0) {
+        row = 0;
+    }
+    if (row > console->screen_row) {
+        row = console->screen_row;
+    }
+    console->view_row = row;
+    set_start_row(console_base_row(console) + console->view_row);
+    irq_restore(flags);
+}
+
 /*
+ * The keyboard IRQ echoes onto the same consoles threads print to, so
+ * every public function that touches a console's cursor or buffer runs
+ * with interrupts off.
+ *
  * TODO:
  * - handle illegal offset (print error message somewhere)
  */
-void print_string(char *string) {
-    int offset = get_cursor();
+void console_print_string(int console_index, char *string) {
+    uint32_t flags = irq_save();
+    console_t *console = &consoles[console_index];
+    int offset = console->cursor;
     int i = 0;
     while (string[i] != 0) {
         if (offset >= MAX_ROWS * MAX_COLS * 2) {
-            offset = scroll_ln(offset);
+            offset = console_scroll_ln(console, offset);
         }
         if (string[i] == '\n') {
             offset = move_offset_to_new_line(offset);
         } else {
-            set_char_at_video_memory(string[i], offset);
+            console_set_char(console, string[i], offset);
             offset += 2;
         }
         i++;
     }
-    set_cursor(offset);
+    console_set_cursor(console, offset);
+    irq_restore(flags);
 }
 
-void print_nl() {
-    int newOffset = move_offset_to_new_line(get_cursor());
+void console_print_nl(int console_index) {
+    uint32_t flags = irq_save();
+    console_t *console = &consoles[console_index];
+    int newOffset = move_offset_to_new_line(console->cursor);
     if (newOffset >= MAX_ROWS * MAX_COLS * 2) {
-        newOffset = scroll_ln(newOffset);
+        newOffset = console_scroll_ln(console, newOffset);
     }
-    set_cursor(newOffset);
+    console_set_cursor(console, newOffset);
+    irq_restore(flags);
+}
+
+void console_print_backspace(int console_index) {
+    uint32_t flags = irq_save();
+    console_t *console = &consoles[console_index];
+    int newCursor = console->cursor - 2;
+    console_set_char(console, ' ', newCursor);
+    console_set_cursor(console, newCursor);
+    irq_restore(flags);
+}
+
+void print_string(char *string) {
+    console_print_string(output_console, string);
+}
+
+void print_number(uint32_t value) {
+    char ascii[12];
+    int_to_string(value, ascii);
+    print_string(ascii);
+}
+
+void print_nl() {
+    console_print_nl(output_console);
 }
 
 void print_backspace() {
-    int newCursor = get_cursor() - 2;
-    set_char_at_video_memory(' ', newCursor);
-    set_cursor(newCursor);
+    console_print_backspace(output_console);
 }
 
 void clear_screen() {
+    uint32_t flags = irq_save();
+    console_t *console = &consoles[output_console];
+    console->screen_row = 0;
     int screen_size = MAX_COLS * MAX_ROWS;
     for (int i = 0; i < screen_size; ++i) {
-        set_char_at_video_memory(' ', i * 2);
+        console_set_char(console, ' ', i * 2);
+    }
+    console_set_cursor(console, get_offset(0, 0));
+    irq_restore(flags);
+}
+
+void switch_console(int console_index) {
+    if (console_index < 0 || console_index >= NUM_CONSOLES) {
+        return;
+    }
+    uint32_t flags = irq_save();
+    active_console = console_index;
+    console_t *console = &consoles[active_console];
+    set_start_row(console_base_row(console) + console->view_row);
+    update_hardware_cursor(console);
+    irq_restore(flags);
+}
+
+int get_active_console() {
+    return active_console;
+}
+
+void set_output_console(int console_index) {
+    if (console_index >= 0 && console_index < NUM_CONSOLES) {
+        output_console = console_index;
     }
-    set_cursor(get_offset(0, 0));
-}
\ No newline at end of file
+}
+
+int get_output_console() {
+    return output_console;
+}
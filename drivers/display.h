@@ -1,20 +1,44 @@
 #pragma once
 
+#include <stdint.h>
+
 #define VIDEO_ADDRESS 0xB8000
 #define MAX_ROWS 25
 #define MAX_COLS 80
 #define WHITE_ON_BLACK 0x02
 
+/* Rows of video memory used for the screens plus scrollback (32 KiB max) */
+#define VGA_BUFFER_ROWS 200
+
+/* Virtual consoles, switched with Alt+F1.. Each gets an equal share of the rows */
+#define NUM_CONSOLES 4
+#define CONSOLE_BUFFER_ROWS (VGA_BUFFER_ROWS / NUM_CONSOLES)
+/* Scrollback rows preserved when a console wraps around to its first row */
+#define SCROLLBACK_KEEP_ROWS 12
+
 /* Screen i/o ports */
 #define REG_SCREEN_CTRL 0x3D4
 #define REG_SCREEN_DATA 0x3D5
 
 /* Public kernel API */
 void print_string(char* string);
+void print_number(uint32_t value); /* in decimal */
 void print_nl();
 void print_backspace();
 void clear_screen();
 int scroll_ln(int offset);
+void scroll_view(int rows);
 
 void set_cursor(int offset);
-int get_offset(int col, int row);
\ No newline at end of file
+int get_offset(int col, int row);
+
+/* print_string and friends write to the output console,
+ * these write to a specific one */
+void console_print_string(int console, char *string);
+void console_print_nl(int console);
+void console_print_backspace(int console);
+
+void switch_console(int console);
+int get_active_console();
+void set_output_console(int console);
+int get_output_console();
\ No newline at end of file
@@ -4,8 +4,15 @@
 #include "display.h"
 #include "../apps/shell.h"
 #include "../kernel/util.h"
+#include "../kernel/channel.h"
+#include "../kernel/mem.h"
+#include "../cpu/paging.h"
 
-static char key_buffer[256];
+/* Input line of every console, a page that goes to the shell on ENTER
+ * and is replaced by a fresh one on the next key */
+static char *key_buffer[NUM_CONSOLES];
+static bool shift_pressed = false;
+static bool alt_pressed = false;
 
 // const char scancode_to_char[] = {
 //     '?', '`', '1', '2', '3', '4', '5', '6', '7', '8', '9', '0', '-', '=',
@@ -218,25 +225,66 @@ void print_letter(uint8_t scancode) {
     }
 }
 
-static void keyboard_callback(registers_t *regs) {
+static bool keyboard_callback(registers_t *regs) {
     uint8_t scancode = port_byte_in(0x60);
 
-    if (scancode > SC_MAX) return;
+    if (scancode == LSHIFT || scancode == RSHIFT) {
+        shift_pressed = true;
+        return IRQ_HANDLED;
+    }
+    if (scancode == LSHIFT + KEY_RELEASED || scancode == RSHIFT + KEY_RELEASED) {
+        shift_pressed = false;
+        return IRQ_HANDLED;
+    }
+    if (scancode == LALT) {
+        alt_pressed = true;
+        return IRQ_HANDLED;
+    }
+    if (scancode == LALT + KEY_RELEASED) {
+        alt_pressed = false;
+        return IRQ_HANDLED;
+    }
+    if (alt_pressed && scancode >= F1 && scancode < F1 + NUM_CONSOLES) {
+        switch_console(scancode - F1);
+        return IRQ_HANDLED;
+    }
+    if (shift_pressed && scancode == PAGE_UP) {
+        scroll_view(-MAX_ROWS / 2);
+        return IRQ_HANDLED;
+    }
+    if (shift_pressed && scancode == PAGE_DOWN) {
+        scroll_view(MAX_ROWS / 2);
+        return IRQ_HANDLED;
+    }
+
+    if (scancode > SC_MAX) return IRQ_HANDLED;
 
+    int console = get_active_console();
+    char *line = key_buffer[console];
+    if (line == NULL_POINTER) {
+        line = key_buffer[console] = page_buffer_alloc();
+        if (line == NULL_POINTER) {
+            return IRQ_HANDLED; /* out of memory, the key is lost */
+        }
+        line[0] = '\0';
+    }
     if (scancode == BACKSPACE) {
-        if (backspace(key_buffer)) {
-            print_backspace();
+        if (backspace(line)) {
+            console_print_backspace(console);
         }
     } else if (scancode == ENTER) {
-        print_nl();
-        execute_command(key_buffer);
-        key_buffer[0] = '\0';
-    } else {
+        /* Ignored while the shell has a backlog of lines */
+        if (shell_submit_line(console, line)) {
+            console_print_nl(console);
+            key_buffer[console] = NULL_POINTER;
+        }
+    } else if (string_length(line) < PAGE_SIZE - 1) {
         char letter = scancode_to_char[(int) scancode];
-        append(key_buffer, letter);
+        append(line, letter);
         char str[2] = {letter, '\0'};
-        print_string(str);
+        console_print_string(console, str);
     }
+    return IRQ_HANDLED;
 }
 
 void init_keyboard() {
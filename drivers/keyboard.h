@@ -3,5 +3,12 @@
 #define SC_MAX 57
 #define BACKSPACE 0x0E
 #define ENTER 0x1C
+#define LSHIFT 0x2A
+#define LALT 0x38
+#define F1 0x3B /* F2.. follow */
+#define RSHIFT 0x36
+#define PAGE_UP 0x49
+#define PAGE_DOWN 0x51
+#define KEY_RELEASED 0x80 /* added to the scancode of a key going up */
 
 void init_keyboard();
\ No newline at end of file
@@ -0,0 +1,122 @@
+#include "pci.h"
+#include "display.h"
+#include "ports.h"
+#include "../kernel/mem.h"
+#include "../kernel/util.h"
+
+#define PCI_CONFIG_ADDRESS 0xCF8
+#define PCI_CONFIG_DATA 0xCFC
+#define PCI_ENABLE (1u << 31)
+
+#define PCI_BUSES 256
+#define PCI_SLOTS 32
+#define PCI_FUNCTIONS 8
+#define PCI_HEADER_MULTIFUNCTION 0x80
+#define PCI_NO_DEVICE 0xFFFF
+
+static pci_device_t pci_devices[MAX_PCI_DEVICES];
+static int pci_device_count = 0;
+
+static uint32_t config_read(uint8_t bus, uint8_t slot, uint8_t function, uint8_t offset) {
+    port_dword_out(PCI_CONFIG_ADDRESS, PCI_ENABLE | (bus << 16) | (slot << 11) | (function << 8) | (offset & 0xFC));
+    return port_dword_in(PCI_CONFIG_DATA);
+}
+
+uint32_t pci_config_read(pci_device_t *device, uint8_t offset) {
+    return config_read(device->bus, device->slot, device->function, offset);
+}
+
+void pci_config_write(pci_device_t *device, uint8_t offset, uint32_t value) {
+    port_dword_out(PCI_CONFIG_ADDRESS, PCI_ENABLE | (device->bus << 16) | (device->slot << 11)
+                                       | (device->function << 8) | (offset & 0xFC));
+    port_dword_out(PCI_CONFIG_DATA, value);
+}
+
+static void add_function(uint8_t bus, uint8_t slot, uint8_t function, uint32_t id) {
+    if (pci_device_count == MAX_PCI_DEVICES) {
+        return;
+    }
+    pci_device_t *device = &pci_devices[pci_device_count++];
+    device->bus = bus;
+    device->slot = slot;
+    device->function = function;
+    device->vendor_id = id & 0xFFFF;
+    device->device_id = id >> 16;
+    uint32_t class = pci_config_read(device, PCI_CLASS);
+    device->class_code = class >> 24;
+    device->subclass = class >> 16;
+    device->irq = pci_config_read(device, PCI_INTERRUPT_LINE) & 0xFF;
+}
+
+void init_pci() {
+    for (int bus = 0; bus < PCI_BUSES; bus++) {
+        for (int slot = 0; slot < PCI_SLOTS; slot++) {
+            uint32_t id = config_read(bus, slot, 0, PCI_VENDOR_ID);
+            if ((id & 0xFFFF) == PCI_NO_DEVICE) {
+                continue;
+            }
+            add_function(bus, slot, 0, id);
+            uint8_t header_type = config_read(bus, slot, 0, PCI_HEADER_TYPE) >> 16;
+            if (!(header_type & PCI_HEADER_MULTIFUNCTION)) {
+                continue;
+            }
+            for (int function = 1; function < PCI_FUNCTIONS; function++) {
+                id = config_read(bus, slot, function, PCI_VENDOR_ID);
+                if ((id & 0xFFFF) != PCI_NO_DEVICE) {
+                    add_function(bus, slot, function, id);
+                }
+            }
+        }
+    }
+}
+
+pci_device_t *pci_find_device(uint16_t vendor_id, uint16_t device_id, int index) {
+    for (int i = 0; i < pci_device_count; i++) {
+        if (pci_devices[i].vendor_id == vendor_id && pci_devices[i].device_id == device_id && index-- == 0) {
+            return &pci_devices[i];
+        }
+    }
+    return NULL_POINTER;
+}
+
+uint16_t pci_io_base(pci_device_t *device, int bar) {
+    uint32_t value = pci_config_read(device, PCI_BAR0 + bar * 4);
+    if (!(value & PCI_BAR_IO)) {
+        return 0;
+    }
+    return value & 0xFFFC;
+}
+
+void pci_enable_io_and_dma(pci_device_t *device) {
+    uint32_t command = pci_config_read(device, PCI_COMMAND);
+    /* The upper half is the status register, writing its bits back would clear them */
+    command = (command & 0xFFFF) | PCI_COMMAND_IO | PCI_COMMAND_BUS_MASTER;
+    pci_config_write(device, PCI_COMMAND, command);
+}
+
+/* One line per function: bus:slot.function vendor:device class irq */
+void print_pci_devices() {
+    char hex[12]; /* only the last four digits are printed */
+    for (int i = 0; i < pci_device_count; i++) {
+        pci_device_t *device = &pci_devices[i];
+        print_number(device->bus);
+        print_string(":");
+        print_number(device->slot);
+        print_string(".");
+        print_number(device->function);
+        print_string(" ");
+        hex_to_string(device->vendor_id, hex);
+        print_string(hex + 6);
+        print_string(":");
+        hex_to_string(device->device_id, hex);
+        print_string(hex + 6);
+        print_string(" class ");
+        hex_to_string(device->class_code << 8 | device->subclass, hex);
+        print_string(hex + 6);
+        if (device->irq != 0 && device->irq != 0xFF) {
+            print_string(" irq ");
+            print_number(device->irq);
+        }
+        print_nl();
+    }
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// https://wiki.osdev.org/PCI, configuration space access mechanism #1
+
+/* Offsets into the configuration space header (type 0) */
+#define PCI_VENDOR_ID 0x00
+#define PCI_COMMAND 0x04
+#define PCI_CLASS 0x08 /* revision, prog if, subclass, class */
+#define PCI_HEADER_TYPE 0x0C /* byte 2 of the dword */
+#define PCI_BAR0 0x10
+#define PCI_INTERRUPT_LINE 0x3C
+
+#define PCI_COMMAND_IO 0x1
+#define PCI_COMMAND_MEMORY 0x2
+#define PCI_COMMAND_BUS_MASTER 0x4
+
+#define PCI_BAR_IO 0x1
+
+typedef struct {
+    uint8_t bus;
+    uint8_t slot;
+    uint8_t function;
+    uint16_t vendor_id;
+    uint16_t device_id;
+    uint8_t class_code;
+    uint8_t subclass;
+    uint8_t irq; /* legacy PIC line, as assigned by the firmware */
+} pci_device_t;
+
+#define MAX_PCI_DEVICES 32
+
+/* Scan every bus for functions that are present */
+void init_pci();
+
+uint32_t pci_config_read(pci_device_t *device, uint8_t offset);
+
+void pci_config_write(pci_device_t *device, uint8_t offset, uint32_t value);
+
+/* The 'index'th function with this vendor and device id, NULL if none */
+pci_device_t *pci_find_device(uint16_t vendor_id, uint16_t device_id, int index);
+
+/* Port of an I/O BAR, 0 if 'bar' is not one */
+uint16_t pci_io_base(pci_device_t *device, int bar);
+
+/* Turn on I/O space decoding and let the function DMA into memory */
+void pci_enable_io_and_dma(pci_device_t *device);
+
+void print_pci_devices();
@@ -13,7 +13,7 @@ unsigned char port_byte_in(uint16_t port) {
      *
      * Inputs and outputs are separated by colons
      */
-    asm("in %%dx, %%al" : "=a" (result) : "d" (port));
+    asm volatile("in %%dx, %%al" : "=a" (result) : "d" (port));
     return result;
 }
 
@@ -23,15 +23,34 @@ void port_byte_out(uint16_t port, uint8_t data) {
      * However we see a comma since there are two variables in the input area
      * and none in the 'return' area
      */
-    asm("out %%al, %%dx" : : "a" (data), "d" (port));
+    asm volatile("out %%al, %%dx" : : "a" (data), "d" (port));
 }
 
 unsigned short port_word_in(uint16_t port) {
     unsigned short result;
-    asm("in %%dx, %%ax" : "=a" (result) : "d" (port));
+    asm volatile("in %%dx, %%ax" : "=a" (result) : "d" (port));
     return result;
 }
 
 void port_word_out(uint16_t port, uint16_t data) {
-    asm("out %%ax, %%dx" : : "a" (data), "d" (port));
-}
\ No newline at end of file
+    asm volatile("out %%ax, %%dx" : : "a" (data), "d" (port));
+}
+
+unsigned int port_dword_in(uint16_t port) {
+    unsigned int result;
+    asm volatile("in %%dx, %%eax" : "=a" (result) : "d" (port));
+    return result;
+}
+
+void port_dword_out(uint16_t port, uint32_t data) {
+    asm volatile("out %%eax, %%dx" : : "a" (data), "d" (port));
+}
+
+/* Read/write 'count' words from/to the same port, e.g. an ATA sector */
+void port_words_in(uint16_t port, uint16_t *buffer, uint32_t count) {
+    asm volatile("rep insw" : "+D" (buffer), "+c" (count) : "d" (port) : "memory");
+}
+
+void port_words_out(uint16_t port, uint16_t *buffer, uint32_t count) {
+    asm volatile("rep outsw" : "+S" (buffer), "+c" (count) : "d" (port) : "memory");
+}
@@ -0,0 +1,40 @@
+#include "serial.h"
+#include "ports.h"
+
+// https://wiki.osdev.org/Serial_Ports
+
+#define SERIAL_DATA (COM1 + 0)
+#define SERIAL_INTERRUPT_ENABLE (COM1 + 1)
+#define SERIAL_FIFO_CONTROL (COM1 + 2)
+#define SERIAL_LINE_CONTROL (COM1 + 3)
+#define SERIAL_MODEM_CONTROL (COM1 + 4)
+#define SERIAL_LINE_STATUS (COM1 + 5)
+
+#define SERIAL_LINE_DLAB 0x80 /* the first two registers set the divisor */
+#define SERIAL_LINE_8N1 0x03
+#define SERIAL_STATUS_THR_EMPTY 0x20
+
+void init_serial() {
+    port_byte_out(SERIAL_INTERRUPT_ENABLE, 0x00);
+    port_byte_out(SERIAL_LINE_CONTROL, SERIAL_LINE_DLAB);
+    port_byte_out(SERIAL_DATA, 1); /* divisor 1: 115200 baud */
+    port_byte_out(SERIAL_INTERRUPT_ENABLE, 0);
+    port_byte_out(SERIAL_LINE_CONTROL, SERIAL_LINE_8N1);
+    port_byte_out(SERIAL_FIFO_CONTROL, 0xC7); /* enable and clear FIFOs, 14 byte threshold */
+    port_byte_out(SERIAL_MODEM_CONTROL, 0x03); /* DTR, RTS */
+}
+
+void serial_write_char(char c) {
+    while (!(port_byte_in(SERIAL_LINE_STATUS) & SERIAL_STATUS_THR_EMPTY)) {
+    }
+    port_byte_out(SERIAL_DATA, c);
+}
+
+void serial_print_string(char *string) {
+    for (int i = 0; string[i] != 0; i++) {
+        if (string[i] == '\n') {
+            serial_write_char('\r');
+        }
+        serial_write_char(string[i]);
+    }
+}
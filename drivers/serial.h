@@ -0,0 +1,12 @@
+#pragma once
+
+#include <stdint.h>
+
+#define COM1 0x3F8
+
+/* COM1 at 115200 baud, 8N1, polled */
+void init_serial();
+
+void serial_write_char(char c);
+
+void serial_print_string(char *string);
@@ -0,0 +1,157 @@
+#include "virtio.h"
+#include "ports.h"
+#include "../kernel/mem.h"
+
+/* The device reads and writes the rings concurrently. Ordering of stores
+ * against stores and loads against loads is guaranteed on x86, only the
+ * compiler has to be stopped; a store followed by a load needs a fence. */
+#define virtio_barrier() asm volatile("" : : : "memory")
+#define virtio_fence() asm volatile("lock; orl $0, (%%esp)" : : : "memory")
+
+/* Right behind the rings */
+#define used_event(queue) ((queue)->avail->ring[(queue)->size])
+#define avail_event(queue) (*(volatile uint16_t *) ((volatile uint8_t *) (queue)->used + 4 + 8 * (queue)->size))
+
+uint32_t virtio_negotiate(uint16_t io_base, uint32_t supported_features) {
+    port_byte_out(io_base + VIRTIO_DEVICE_STATUS, 0); /* reset */
+    port_byte_out(io_base + VIRTIO_DEVICE_STATUS, VIRTIO_STATUS_ACKNOWLEDGE);
+    port_byte_out(io_base + VIRTIO_DEVICE_STATUS, VIRTIO_STATUS_ACKNOWLEDGE | VIRTIO_STATUS_DRIVER);
+    uint32_t features = port_dword_in(io_base + VIRTIO_DEVICE_FEATURES) & supported_features;
+    port_dword_out(io_base + VIRTIO_GUEST_FEATURES, features);
+    return features;
+}
+
+void virtio_driver_ok(uint16_t io_base) {
+    port_byte_out(io_base + VIRTIO_DEVICE_STATUS,
+                  VIRTIO_STATUS_ACKNOWLEDGE | VIRTIO_STATUS_DRIVER | VIRTIO_STATUS_DRIVER_OK);
+}
+
+void virtio_fail(uint16_t io_base) {
+    port_byte_out(io_base + VIRTIO_DEVICE_STATUS, VIRTIO_STATUS_FAILED);
+}
+
+bool virtq_init(virtqueue_t *queue, uint16_t io_base, uint16_t index, uint8_t *memory, bool event_index) {
+    port_word_out(io_base + VIRTIO_QUEUE_SELECT, index);
+    uint16_t size = port_word_in(io_base + VIRTIO_QUEUE_SIZE);
+    if (size == 0 || size > VIRTQ_MAX_SIZE) {
+        return false;
+    }
+    for (int i = 0; i < VIRTQ_BYTES(size); i++) {
+        memory[i] = 0;
+    }
+
+    queue->io_base = io_base;
+    queue->index = index;
+    queue->size = size;
+    queue->event_index = event_index;
+    queue->desc = (virtq_desc_t *) memory;
+    queue->avail = (virtq_avail_t *) (memory + VIRTQ_AVAIL_OFFSET(size));
+    queue->used = (virtq_used_t *) (memory + VIRTQ_USED_OFFSET(size));
+    for (int i = 0; i < size; i++) {
+        queue->desc[i].next = i + 1;
+        queue->tokens[i] = NULL_POINTER;
+    }
+    queue->free_head = 0;
+    queue->free_count = size;
+    queue->avail_index = 0;
+    queue->kicked_index = 0;
+    queue->last_used = 0;
+    queue->notifications = 0;
+    queue->notifications_suppressed = 0;
+
+    /* Identity mapped, the address is the physical one */
+    port_dword_out(io_base + VIRTIO_QUEUE_ADDRESS, (uint32_t) memory / 4096);
+    return true;
+}
+
+bool virtq_add(virtqueue_t *queue, virtq_buffer_t *buffers, int count, void *token) {
+    if (count == 0 || count > queue->free_count) {
+        return false;
+    }
+    uint16_t head = queue->free_head;
+    uint16_t last = head;
+    for (int i = 0; i < count; i++) {
+        volatile virtq_desc_t *desc = &queue->desc[last];
+        desc->address = buffers[i].address;
+        desc->length = buffers[i].length;
+        desc->flags = (buffers[i].device_writes ? VIRTQ_DESC_F_WRITE : 0) | (i + 1 < count ? VIRTQ_DESC_F_NEXT : 0);
+        if (i + 1 < count) {
+            last = desc->next;
+        }
+    }
+    queue->free_head = queue->desc[last].next;
+    queue->free_count -= count;
+    queue->tokens[head] = token;
+
+    queue->avail->ring[queue->avail_index % queue->size] = head;
+    queue->avail_index++;
+    return true;
+}
+
+/* Did the index move past 'event' going from 'old' to 'new'? (2.4.7.2) */
+static bool need_event(uint16_t event, uint16_t new, uint16_t old) {
+    return (uint16_t) (new - event - 1) < (uint16_t) (new - old);
+}
+
+void virtq_kick(virtqueue_t *queue) {
+    uint16_t old = queue->kicked_index;
+    uint16_t new = queue->avail_index;
+    if (old == new) {
+        return;
+    }
+    virtio_barrier(); /* ring entries before the index */
+    queue->avail->index = new;
+    queue->kicked_index = new;
+    virtio_fence(); /* the index before reading what the device wants */
+
+    bool notify = queue->event_index ? need_event(avail_event(queue), new, old)
+                                     : !(queue->used->flags & VIRTQ_USED_F_NO_NOTIFY);
+    if (notify) {
+        queue->notifications++;
+        port_word_out(queue->io_base + VIRTIO_QUEUE_NOTIFY, queue->index);
+    } else {
+        queue->notifications_suppressed++;
+    }
+}
+
+void *virtq_get_used(virtqueue_t *queue) {
+    if (queue->last_used == queue->used->index) {
+        return NULL_POINTER;
+    }
+    virtio_barrier(); /* the index before the entry */
+    uint16_t head = queue->used->ring[queue->last_used % queue->size].id;
+    queue->last_used++;
+
+    /* Put the chain back on the free list */
+    uint16_t last = head;
+    uint16_t count = 1;
+    while (queue->desc[last].flags & VIRTQ_DESC_F_NEXT) {
+        last = queue->desc[last].next;
+        count++;
+    }
+    queue->desc[last].next = queue->free_head;
+    queue->free_head = head;
+    queue->free_count += count;
+
+    void *token = queue->tokens[head];
+    queue->tokens[head] = NULL_POINTER;
+    return token;
+}
+
+void virtq_disable_interrupts(virtqueue_t *queue) {
+    /* With event indices used_event stays behind the entries being drained,
+     * which is already enough for the device to hold back */
+    if (!queue->event_index) {
+        queue->avail->flags |= VIRTQ_AVAIL_F_NO_INTERRUPT;
+    }
+}
+
+bool virtq_enable_interrupts(virtqueue_t *queue) {
+    if (queue->event_index) {
+        used_event(queue) = queue->last_used; /* interrupt for the next entry */
+    } else {
+        queue->avail->flags &= ~VIRTQ_AVAIL_F_NO_INTERRUPT;
+    }
+    virtio_fence(); /* publish before checking for entries that raced with it */
+    return queue->last_used != queue->used->index;
+}
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Legacy virtio over PCI (virtio 1.0 spec 4.1.4.8) with split virtqueues (2.4)
+
+#define VIRTIO_VENDOR_ID 0x1AF4
+
+/* Registers at the start of BAR 0 (I/O space) */
+#define VIRTIO_DEVICE_FEATURES 0x00
+#define VIRTIO_GUEST_FEATURES 0x04
+#define VIRTIO_QUEUE_ADDRESS 0x08 /* page number of the ring memory */
+#define VIRTIO_QUEUE_SIZE 0x0C
+#define VIRTIO_QUEUE_SELECT 0x0E
+#define VIRTIO_QUEUE_NOTIFY 0x10
+#define VIRTIO_DEVICE_STATUS 0x12
+#define VIRTIO_ISR_STATUS 0x13 /* reading it acknowledges the interrupt */
+#define VIRTIO_DEVICE_CONFIG 0x14 /* device specific, without MSI-X */
+
+#define VIRTIO_STATUS_ACKNOWLEDGE 0x1
+#define VIRTIO_STATUS_DRIVER 0x2
+#define VIRTIO_STATUS_DRIVER_OK 0x4
+#define VIRTIO_STATUS_FAILED 0x80
+
+#define VIRTIO_ISR_QUEUE 0x1
+#define VIRTIO_ISR_CONFIG 0x2
+
+/* used_event/avail_event instead of the flags below */
+#define VIRTIO_F_EVENT_IDX (1 << 29)
+
+#define VIRTQ_DESC_F_NEXT 0x1
+#define VIRTQ_DESC_F_WRITE 0x2 /* the device writes into the buffer */
+
+#define VIRTQ_AVAIL_F_NO_INTERRUPT 0x1
+#define VIRTQ_USED_F_NO_NOTIFY 0x1
+
+/* Largest queue we have ring memory for */
+#define VIRTQ_MAX_SIZE 256
+
+/* Legacy layout: descriptor table and available ring, the used ring starts
+ * on the next page */
+#define VIRTQ_AVAIL_OFFSET(size) (16 * (size))
+#define VIRTQ_USED_OFFSET(size) (((16 * (size) + 6 + 2 * (size)) + 4095) & ~4095)
+#define VIRTQ_BYTES(size) (VIRTQ_USED_OFFSET(size) + ((6 + 8 * (size) + 4095) & ~4095))
+
+typedef struct {
+    uint64_t address; /* physical */
+    uint32_t length;
+    uint16_t flags;
+    uint16_t next;
+} __attribute__((packed)) virtq_desc_t;
+
+typedef struct {
+    uint16_t flags;
+    uint16_t index;
+    uint16_t ring[]; /* followed by used_event */
+} __attribute__((packed)) virtq_avail_t;
+
+typedef struct {
+    uint32_t id; /* head of the descriptor chain */
+    uint32_t length; /* bytes written by the device */
+} __attribute__((packed)) virtq_used_elem_t;
+
+typedef struct {
+    uint16_t flags;
+    uint16_t index;
+    virtq_used_elem_t ring[]; /* followed by avail_event */
+} __attribute__((packed)) virtq_used_t;
+
+/* One physically contiguous piece of a request */
+typedef struct {
+    uint32_t address; /* physical */
+    uint32_t length;
+    bool device_writes;
+} virtq_buffer_t;
+
+typedef struct {
+    uint16_t io_base;
+    uint16_t index;
+    uint16_t size;
+    bool event_index; /* VIRTIO_F_EVENT_IDX was negotiated */
+
+    volatile virtq_desc_t *desc;
+    volatile virtq_avail_t *avail;
+    volatile virtq_used_t *used;
+
+    uint16_t free_head; /* unused descriptors, linked through 'next' */
+    uint16_t free_count;
+    uint16_t avail_index; /* chains added, published to the device by virtq_kick */
+    uint16_t kicked_index; /* what the device had been told at the last kick */
+    uint16_t last_used; /* next used ring entry to look at */
+    void *tokens[VIRTQ_MAX_SIZE]; /* by head descriptor, returned by virtq_get_used */
+
+    uint32_t notifications;
+    uint32_t notifications_suppressed; /* kicks the device said it didn't need */
+} virtqueue_t;
+
+/* Reset the device and agree on features; returns the negotiated ones */
+uint32_t virtio_negotiate(uint16_t io_base, uint32_t supported_features);
+
+/* Tell the device the driver is ready, after its queues are set up */
+void virtio_driver_ok(uint16_t io_base);
+
+void virtio_fail(uint16_t io_base);
+
+/* Set up queue 'index' in 'memory', which must be VIRTQ_BYTES(VIRTQ_MAX_SIZE)
+ * bytes, page aligned and identity mapped. False if the device has no such
+ * queue or it is larger than VIRTQ_MAX_SIZE. */
+bool virtq_init(virtqueue_t *queue, uint16_t io_base, uint16_t index, uint8_t *memory, bool event_index);
+
+/* Put 'buffers' on the available ring as one descriptor chain. The device
+ * only sees it after virtq_kick, so several chains can go out with one
+ * notification. False if there aren't 'count' free descriptors. */
+bool virtq_add(virtqueue_t *queue, virtq_buffer_t *buffers, int count, void *token);
+
+/* Publish the added chains, notifying the device unless it asked not to be */
+void virtq_kick(virtqueue_t *queue);
+
+/* Token of the next chain the device is done with, NULL if there is none.
+ * Its descriptors are free again. */
+void *virtq_get_used(virtqueue_t *queue);
+
+/* Interrupt suppression while draining the used ring: disable, drain, then
+ * enable. enable returns true if more entries arrived in between, the caller
+ * has to drain again (and the interrupt for them may not come). */
+void virtq_disable_interrupts(virtqueue_t *queue);
+bool virtq_enable_interrupts(virtqueue_t *queue);
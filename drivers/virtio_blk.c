@@ -0,0 +1,229 @@
+#include "virtio_blk.h"
+#include "virtio.h"
+#include "block.h"
+#include "display.h"
+#include "pci.h"
+#include "ports.h"
+#include "../cpu/isr.h"
+#include "../cpu/paging.h"
+#include "../kernel/mem.h"
+#include "../kernel/util.h"
+
+// virtio 1.0 spec 5.2
+
+#define VIRTIO_BLK_DEVICE_ID 0x1001 /* transitional, speaks the legacy interface */
+#define VIRTIO_BLK_CAPACITY (VIRTIO_DEVICE_CONFIG + 0) /* 64 bit, in sectors */
+
+#define VIRTIO_BLK_T_IN 0
+#define VIRTIO_BLK_T_OUT 1
+#define VIRTIO_BLK_S_OK 0
+
+/* Merged requests are one descriptor chain: header, a descriptor per
+ * physically contiguous piece of each buffer, status. A sector never spans
+ * more than two pages, which bounds the chain. */
+#define VIRTIO_BLK_MAX_SECTORS 16
+#define VIRTIO_BLK_MAX_DESCRIPTORS (2 + 2 * VIRTIO_BLK_MAX_SECTORS)
+#define VIRTIO_BLK_MAX_ACTIVE 8
+#define MAX_VIRTIO_BLK_DEVICES 2
+
+typedef struct {
+    uint32_t type;
+    uint32_t reserved;
+    uint64_t sector;
+} __attribute__((packed)) virtio_blk_header_t;
+
+/* One command in flight, header and status are read/written by the device */
+typedef struct {
+    virtio_blk_header_t header;
+    volatile uint8_t status;
+    block_request_t *request; /* NULL while the slot is free */
+} virtio_blk_command_t;
+
+typedef struct {
+    block_device_t device;
+    uint16_t io_base;
+    uint8_t irq;
+    virtqueue_t queue;
+    virtio_blk_command_t commands[VIRTIO_BLK_MAX_ACTIVE];
+    uint32_t interrupts;
+    uint32_t completions;
+} virtio_blk_t;
+
+static virtio_blk_t virtio_blks[MAX_VIRTIO_BLK_DEVICES];
+static int virtio_blk_count = 0;
+static uint8_t ring_memory[MAX_VIRTIO_BLK_DEVICES][VIRTQ_BYTES(VIRTQ_MAX_SIZE)] __attribute__((aligned(PAGE_SIZE)));
+static char *virtio_blk_names[MAX_VIRTIO_BLK_DEVICES] = {"vda", "vdb"};
+
+/* Append the physically contiguous pieces of [address, address + length) */
+static int add_segments(virtq_buffer_t *buffers, int count, uint32_t address, uint32_t length, bool device_writes) {
+    while (length > 0) {
+        uint32_t piece = length;
+        uint32_t physical = address;
+        if (address + length > IDENTITY_MAP_SIZE) {
+            piece = PAGE_SIZE - (address & ~PAGE_MASK);
+            if (piece > length) {
+                piece = length;
+            }
+            /* Heap pages only get a frame when touched */
+            (void) *(volatile uint8_t *) address;
+            physical = virtual_to_physical(address);
+        }
+        buffers[count].address = physical;
+        buffers[count].length = piece;
+        buffers[count].device_writes = device_writes;
+        count++;
+        address += piece;
+        length -= piece;
+    }
+    return count;
+}
+
+static void virtio_blk_start(block_device_t *device, block_request_t *request) {
+    virtio_blk_t *blk = device->driver_data;
+    virtio_blk_command_t *command = blk->commands;
+    while (command->request != NULL_POINTER) {
+        command++; /* the block layer keeps at most max_active in flight */
+    }
+    command->request = request;
+    command->header.type = request->op == BLOCK_READ ? VIRTIO_BLK_T_IN : VIRTIO_BLK_T_OUT;
+    command->header.reserved = 0;
+    command->header.sector = request->sector;
+    command->status = 0xFF;
+
+    virtq_buffer_t buffers[VIRTIO_BLK_MAX_DESCRIPTORS];
+    int count = add_segments(buffers, 0, (uint32_t) &command->header, sizeof(command->header), false);
+    for (block_request_t *part = request; part != NULL_POINTER; part = part->chain) {
+        count = add_segments(buffers, count, (uint32_t) part->buffer, part->count * SECTOR_SIZE,
+                             request->op == BLOCK_READ);
+    }
+    count = add_segments(buffers, count, (uint32_t) &command->status, 1, true);
+
+    /* Goes out with the next kick */
+    if (!virtq_add(&blk->queue, buffers, count, command)) {
+        command->request = NULL_POINTER;
+        block_complete(device, request, BLOCK_ERROR);
+    }
+}
+
+static void virtio_blk_kick(block_device_t *device) {
+    virtio_blk_t *blk = device->driver_data;
+    virtq_kick(&blk->queue);
+}
+
+static void drain_used(virtio_blk_t *blk) {
+    virtio_blk_command_t *command;
+    while ((command = virtq_get_used(&blk->queue)) != NULL_POINTER) {
+        block_request_t *request = command->request;
+        command->request = NULL_POINTER;
+        blk->completions++;
+        block_complete(&blk->device, request, command->status == VIRTIO_BLK_S_OK ? BLOCK_OK : BLOCK_ERROR);
+    }
+}
+
+/* The line may be shared with other PCI functions, the ISR status register
+ * tells whether it was us. Completions are collected with further interrupts
+ * suppressed, and everything they let the block layer start goes out in a
+ * single batch. */
+static bool virtio_blk_callback(registers_t *regs) {
+    bool handled = false;
+    for (int i = 0; i < virtio_blk_count; i++) {
+        virtio_blk_t *blk = &virtio_blks[i];
+        if (port_byte_in(blk->io_base + VIRTIO_ISR_STATUS) == 0) {
+            continue;
+        }
+        handled = true;
+        blk->interrupts++;
+
+        block_plug(&blk->device);
+        do {
+            virtq_disable_interrupts(&blk->queue);
+            drain_used(blk);
+        } while (virtq_enable_interrupts(&blk->queue));
+        block_unplug(&blk->device);
+    }
+    return handled ? IRQ_HANDLED : IRQ_NONE;
+}
+
+static bool probe(pci_device_t *pci) {
+    virtio_blk_t *blk = &virtio_blks[virtio_blk_count];
+    blk->io_base = pci_io_base(pci, 0);
+    if (blk->io_base == 0 || pci->irq >= 16) {
+        return false;
+    }
+    pci_enable_io_and_dma(pci);
+
+    uint32_t features = virtio_negotiate(blk->io_base, VIRTIO_F_EVENT_IDX);
+    if (!virtq_init(&blk->queue, blk->io_base, 0, ring_memory[virtio_blk_count], features & VIRTIO_F_EVENT_IDX)
+        || blk->queue.size < VIRTIO_BLK_MAX_DESCRIPTORS) {
+        virtio_fail(blk->io_base);
+        return false;
+    }
+
+    /* Only the low half of the capacity, we address sectors with 32 bits */
+    blk->device.sector_count = port_dword_in(blk->io_base + VIRTIO_BLK_CAPACITY);
+    if (port_dword_in(blk->io_base + VIRTIO_BLK_CAPACITY + 4) != 0) {
+        blk->device.sector_count = 0xFFFFFFFF;
+    }
+    blk->device.name = virtio_blk_names[virtio_blk_count];
+    blk->device.max_sectors = VIRTIO_BLK_MAX_SECTORS;
+    /* Worst case chains must fit the ring */
+    blk->device.max_active = blk->queue.size / VIRTIO_BLK_MAX_DESCRIPTORS;
+    if (blk->device.max_active > VIRTIO_BLK_MAX_ACTIVE) {
+        blk->device.max_active = VIRTIO_BLK_MAX_ACTIVE;
+    }
+    blk->device.start = virtio_blk_start;
+    blk->device.kick = virtio_blk_kick;
+    blk->device.driver_data = blk;
+
+    /* Handlers on a line are chained, sharing it with other functions is
+     * fine. The callback looks at every disk, one registration per line. */
+    blk->irq = pci->irq;
+    bool line_registered = false;
+    for (int i = 0; i < virtio_blk_count; i++) {
+        line_registered |= virtio_blks[i].irq == blk->irq;
+    }
+    virtio_blk_count++;
+    if (!line_registered) {
+        register_interrupt_handler(IRQ0 + blk->irq, virtio_blk_callback);
+    }
+    virtio_driver_ok(blk->io_base);
+    block_register(&blk->device);
+    return true;
+}
+
+void init_virtio_blk() {
+    pci_device_t *pci;
+    for (int i = 0; virtio_blk_count < MAX_VIRTIO_BLK_DEVICES
+                    && (pci = pci_find_device(VIRTIO_VENDOR_ID, VIRTIO_BLK_DEVICE_ID, i)) != NULL_POINTER; i++) {
+        if (!probe(pci)) {
+            print_string("virtio-blk device not usable.\n");
+            continue;
+        }
+        virtio_blk_t *blk = &virtio_blks[virtio_blk_count - 1];
+        print_string("virtio disk ");
+        print_string(blk->device.name);
+        print_string(", ");
+        print_number(blk->device.sector_count / 2);
+        print_string(" KiB, irq ");
+        print_number(pci->irq);
+        print_string(blk->queue.event_index ? ", event index.\n" : ".\n");
+    }
+}
+
+void print_virtio_blk_stats() {
+    for (int i = 0; i < virtio_blk_count; i++) {
+        virtio_blk_t *blk = &virtio_blks[i];
+        print_string(blk->device.name);
+        print_string(" queue: ");
+        print_number(blk->queue.size);
+        print_string(" entries, ");
+        print_number(blk->queue.notifications);
+        print_string(" notifications, ");
+        print_number(blk->queue.notifications_suppressed);
+        print_string(" suppressed, ");
+        print_number(blk->interrupts);
+        print_string(" interrupts for ");
+        print_number(blk->completions);
+        print_string(" completions\n");
+    }
+}
@@ -0,0 +1,6 @@
+#pragma once
+
+/* virtio block devices on PCI (legacy interface), vda, vdb, ... */
+void init_virtio_blk();
+
+void print_virtio_blk_stats();
@@ -0,0 +1,30 @@
+#include "arena.h"
+#include "mem.h"
+
+void arena_init(arena_t *arena, void *buffer, uint32_t size) {
+    arena->base = (uint8_t *) buffer;
+    arena->size = size;
+    arena->used = 0;
+}
+
+void *arena_alloc(arena_t *arena, size_t size) {
+    // round the address up, not the offset, so the buffer needs no alignment
+    uint32_t address = (uint32_t) arena->base + arena->used;
+    uint32_t start = ((address + ARENA_ALIGNMENT - 1) & ~(ARENA_ALIGNMENT - 1)) - (uint32_t) arena->base;
+    if (start > arena->size || size > arena->size - start) {
+        return NULL_POINTER;
+    }
+    arena->used = start + size;
+    return arena->base + start;
+}
+
+arena_mark_t arena_mark(arena_t *arena) {
+    return arena->used;
+}
+
+void arena_reset(arena_t *arena, arena_mark_t mark) {
+    // a mark taken after the current position is stale, ignore it
+    if (mark <= arena->used) {
+        arena->used = mark;
+    }
+}
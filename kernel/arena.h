@@ -0,0 +1,25 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* Bump-pointer arena.
+ * Allocations only move 'used' forward; nothing is freed individually.
+ * Everything allocated after a mark is released at once by resetting to it. */
+typedef struct {
+    uint8_t *base;
+    uint32_t size;
+    uint32_t used;
+} arena_t;
+
+typedef uint32_t arena_mark_t;
+
+#define ARENA_ALIGNMENT 8
+
+void arena_init(arena_t *arena, void *buffer, uint32_t size);
+
+void *arena_alloc(arena_t *arena, size_t size);
+
+arena_mark_t arena_mark(arena_t *arena);
+
+void arena_reset(arena_t *arena, arena_mark_t mark);
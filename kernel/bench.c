@@ -0,0 +1,167 @@
+#include "bench.h"
+#include "mem.h"
+#include "multiboot.h"
+#include "util.h"
+#include "../cpu/syscall.h"
+#include "../cpu/timer.h"
+#include "../cpu/tsc.h"
+#include "../drivers/display.h"
+#include "../drivers/ports.h"
+#include "../drivers/serial.h"
+
+#define CALIBRATION_TICKS 10
+#define INTERRUPT_ITERATIONS 10000
+#define MEM_ITERATIONS 1000
+#define MEM_BLOCKS 8
+#define PRINT_LINES 200
+#define COPY_SIZE (64 * 1024)
+#define COPY_ITERATIONS 16
+
+static uint32_t tsc_khz;
+
+bool bench_requested() {
+    if (multiboot_info == NULL_POINTER || !(multiboot_info->flags & MULTIBOOT_INFO_CMDLINE)) {
+        return false;
+    }
+    /* QEMU passes "<kernel path> <-append string>", look at every word */
+    char *cmdline = (char *) multiboot_info->cmdline;
+    for (int i = 0; cmdline[i] != 0; i++) {
+        if ((i == 0 || cmdline[i - 1] == ' ') && string_starts_with(&cmdline[i], "bench")
+            && (cmdline[i + 5] == 0 || cmdline[i + 5] == ' ')) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void qemu_exit(int code) {
+    port_byte_out(QEMU_EXIT_PORT, code);
+}
+
+static void report(char *key, uint32_t value) {
+    char value_ascii[12];
+    int_to_string(value, value_ascii);
+    char *parts[] = {"bench.", key, "=", value_ascii, "\n"};
+    for (int i = 0; i < 5; i++) {
+        print_string(parts[i]);
+        serial_print_string(parts[i]);
+    }
+}
+
+/* Scaled down first so only 32 bit division is needed */
+uint32_t cycles_per_op(uint64_t cycles, uint32_t ops) {
+    while (cycles >> 32) {
+        cycles >>= 1;
+        ops >>= 1;
+    }
+    return ops == 0 ? 0 : (uint32_t) cycles / ops;
+}
+
+static void wait_ticks(uint32_t ticks) {
+    uint32_t start = get_tick();
+    while (get_tick() - start < ticks) {
+        asm volatile("hlt");
+    }
+}
+
+/* TSC frequency, measured against the PIT */
+static void calibrate_tsc() {
+    wait_ticks(1); /* start on a tick boundary */
+    uint64_t start = rdtsc();
+    wait_ticks(CALIBRATION_TICKS);
+    uint32_t cycles = rdtsc() - start;
+    tsc_khz = cycles / (CALIBRATION_TICKS * 1000 / TIMER_FREQUENCY);
+}
+
+/* Kernel -> int 0x80 -> isr_common_stub -> dispatch -> iret */
+static void bench_interrupt() {
+    uint64_t start = rdtsc();
+    for (int i = 0; i < INTERRUPT_ITERATIONS; i++) {
+        uint32_t result;
+        asm volatile("int $0x80" : "=a" (result) : "a" (SYS_NOP) : "memory");
+    }
+    report("interrupt_roundtrip_cycles", cycles_per_op(rdtsc() - start, INTERRUPT_ITERATIONS));
+}
+
+/* Allocate a handful of differently sized blocks, free them out of order */
+static bool bench_mem() {
+    void *blocks[MEM_BLOCKS];
+    uint64_t start = rdtsc();
+    for (int i = 0; i < MEM_ITERATIONS; i++) {
+        for (int j = 0; j < MEM_BLOCKS; j++) {
+            blocks[j] = mem_alloc(16 << j);
+            if (blocks[j] == NULL_POINTER) {
+                return false;
+            }
+        }
+        for (int j = 0; j < MEM_BLOCKS; j += 2) {
+            mem_free(blocks[j]);
+        }
+        for (int j = 1; j < MEM_BLOCKS; j += 2) {
+            mem_free(blocks[j]);
+        }
+    }
+    report("mem_alloc_free_cycles", cycles_per_op(rdtsc() - start, MEM_ITERATIONS * MEM_BLOCKS));
+    return true;
+}
+
+/* On the last console, so the shell's screen is left alone */
+static void bench_display() {
+    int previous_console = get_output_console();
+    set_output_console(NUM_CONSOLES - 1);
+
+    uint64_t start = rdtsc();
+    for (int i = 0; i < PRINT_LINES; i++) {
+        print_string("The quick brown fox jumps over the lazy dog\n");
+    }
+    report("print_string_line_cycles", cycles_per_op(rdtsc() - start, PRINT_LINES));
+
+    start = rdtsc();
+    for (int i = 0; i < PRINT_LINES; i++) {
+        scroll_ln(get_offset(0, MAX_ROWS));
+    }
+    report("scroll_ln_cycles", cycles_per_op(rdtsc() - start, PRINT_LINES));
+
+    clear_screen();
+    print_string("> ");
+    set_output_console(previous_console);
+}
+
+static bool bench_memory_copy() {
+    uint8_t *source = mem_alloc(COPY_SIZE);
+    uint8_t *dest = mem_alloc(COPY_SIZE);
+    if (source == NULL_POINTER || dest == NULL_POINTER) {
+        return false;
+    }
+    /* Fault the pages in before timing */
+    for (int i = 0; i < COPY_SIZE; i++) {
+        source[i] = i;
+        dest[i] = 0;
+    }
+
+    uint64_t start = rdtsc();
+    for (int i = 0; i < COPY_ITERATIONS; i++) {
+        memory_copy(source, dest, COPY_SIZE);
+    }
+    uint32_t cycles_per_kib = cycles_per_op(rdtsc() - start, COPY_ITERATIONS * COPY_SIZE / 1024);
+    report("memory_copy_cycles_per_kib", cycles_per_kib);
+    if (cycles_per_kib != 0) {
+        report("memory_copy_mib_per_s", tsc_khz / 1024 * 1000 / cycles_per_kib);
+    }
+
+    mem_free(dest);
+    mem_free(source);
+    return true;
+}
+
+bool run_benchmarks() {
+    bool ok = true;
+    calibrate_tsc();
+    report("tsc_khz", tsc_khz);
+    bench_interrupt();
+    ok &= bench_mem();
+    bench_display();
+    ok &= bench_memory_copy();
+    report("ok", ok);
+    return ok;
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Port of QEMU's isa-debug-exit device (see `make bench`). Writing v makes
+ * QEMU exit with status (v << 1) | 1. */
+#define QEMU_EXIT_PORT 0xF4
+#define QEMU_EXIT_SUCCESS 0
+#define QEMU_EXIT_FAILURE 1
+
+/* True if the kernel command line has the 'bench' option */
+bool bench_requested();
+
+/* Run the benchmark suite, printing key=value lines on the screen and
+ * COM1. Returns false if a benchmark couldn't run. */
+bool run_benchmarks();
+
+void qemu_exit(int code);
+
+/* cycles / ops without 64 bit division, for the other benchmarks too */
+uint32_t cycles_per_op(uint64_t cycles, uint32_t ops);
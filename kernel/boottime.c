@@ -0,0 +1,50 @@
+#include "boottime.h"
+#include "util.h"
+#include "../cpu/tsc.h"
+#include "../drivers/display.h"
+
+static boot_log_t *const boot_log = (boot_log_t *) BOOT_LOG_ADDRESS;
+
+void boot_log_stamp(boot_stage_t stage) {
+    boot_log->tsc[stage] = rdtsc();
+}
+
+/* Stages before kernel_entry only exist when we were booted by our MBR */
+static bool boot_stage_valid(boot_stage_t stage) {
+    return stage >= BOOT_KERNEL_ENTRY || boot_log->magic == BOOT_LOG_MAGIC;
+}
+
+static void print_cycles(char *name, uint64_t cycles) {
+    char cycles_ascii[24];
+    uint64_to_string(cycles, cycles_ascii);
+    print_string(name);
+    print_string(": ");
+    print_string(cycles_ascii);
+    print_string(" cycles\n");
+}
+
+/* Print the cycles spent between two stages */
+static void print_boot_phase(char *name, boot_stage_t from, boot_stage_t to) {
+    if (!boot_stage_valid(from)) {
+        print_string(name);
+        print_string(": n/a\n");
+        return;
+    }
+    print_cycles(name, boot_log->tsc[to] - boot_log->tsc[from]);
+}
+
+void print_boot_log() {
+    if (boot_stage_valid(BOOT_MBR_ENTRY)) {
+        print_cycles("BIOS to MBR", boot_log->tsc[BOOT_MBR_ENTRY]);
+    } else {
+        print_string("Not booted from the MBR, no BIOS and MBR stages\n");
+    }
+    print_boot_phase("disk_load", BOOT_DISK_LOAD_BEGIN, BOOT_DISK_LOAD_END);
+    print_boot_phase("switch_to_32bit", BOOT_DISK_LOAD_END, BOOT_PROTECTED_MODE);
+    print_boot_phase("decompress", BOOT_PROTECTED_MODE, BOOT_DECOMPRESS_END);
+    print_boot_phase("stub to kernel", BOOT_DECOMPRESS_END, BOOT_KERNEL_ENTRY);
+    print_boot_phase("clear_screen", BOOT_CLEAR_SCREEN_BEGIN, BOOT_CLEAR_SCREEN_END);
+    print_boot_phase("isr_install", BOOT_ISR_INSTALL_BEGIN, BOOT_ISR_INSTALL_END);
+    print_boot_phase("init_keyboard", BOOT_KEYBOARD_BEGIN, BOOT_KEYBOARD_END);
+    print_boot_phase("kernel entry to shell", BOOT_KERNEL_ENTRY, BOOT_SHELL_READY);
+}
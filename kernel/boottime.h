@@ -0,0 +1,37 @@
+#pragma once
+
+#include <stdint.h>
+
+/* Boot-phase timestamps. The first entries are written by the MBR and
+ * kernel_entry.asm; keep the layout in sync with boot/boot_log.asm. */
+#define BOOT_LOG_ADDRESS 0x600
+#define BOOT_LOG_MAGIC 0x544F4F42
+
+typedef enum {
+    /* recorded in assembly */
+    BOOT_MBR_ENTRY,
+    BOOT_DISK_LOAD_BEGIN,
+    BOOT_DISK_LOAD_END,
+    BOOT_PROTECTED_MODE,
+    BOOT_DECOMPRESS_END,
+    BOOT_KERNEL_ENTRY,
+    /* recorded by main */
+    BOOT_CLEAR_SCREEN_BEGIN,
+    BOOT_CLEAR_SCREEN_END,
+    BOOT_ISR_INSTALL_BEGIN,
+    BOOT_ISR_INSTALL_END,
+    BOOT_KEYBOARD_BEGIN,
+    BOOT_KEYBOARD_END,
+    BOOT_SHELL_READY,
+    BOOT_STAGE_COUNT
+} boot_stage_t;
+
+typedef struct {
+    uint32_t magic; /* BOOT_LOG_MAGIC if the MBR stages are valid */
+    uint32_t reserved;
+    uint64_t tsc[BOOT_STAGE_COUNT];
+} __attribute__((packed)) boot_log_t;
+
+void boot_log_stamp(boot_stage_t stage);
+
+void print_boot_log();
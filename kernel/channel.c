@@ -0,0 +1,189 @@
+#include "channel.h"
+#include "bench.h"
+#include "mem.h"
+#include "util.h"
+#include "../cpu/paging.h"
+#include "../cpu/tsc.h"
+#include "../drivers/display.h"
+
+void channel_init(channel_t *channel) {
+    channel->head = 0;
+    channel->tail = 0;
+    channel->closed = false;
+    wait_queue_init(&channel->senders);
+    wait_queue_init(&channel->receivers);
+    channel->stats = (channel_stats_t) {0};
+}
+
+static bool channel_full(channel_t *channel) {
+    return channel->tail - channel->head == CHANNEL_CAPACITY;
+}
+
+static bool channel_empty(channel_t *channel) {
+    return channel->tail == channel->head;
+}
+
+/* Interrupts must be disabled for these two */
+static bool put(channel_t *channel, message_t message) {
+    if (channel->closed || channel_full(channel)) {
+        return false;
+    }
+    channel->slots[channel->tail % CHANNEL_CAPACITY] = message;
+    channel->tail++;
+    channel->stats.sent++;
+    wake_up(&channel->receivers);
+    return true;
+}
+
+static int take(channel_t *channel, message_t *messages, int max) {
+    int count = 0;
+    while (count < max && !channel_empty(channel)) {
+        messages[count++] = channel->slots[channel->head % CHANNEL_CAPACITY];
+        channel->head++;
+    }
+    if (count > 0) {
+        channel->stats.received += count;
+        wake_up(&channel->senders); /* once for the whole batch */
+    }
+    return count;
+}
+
+bool channel_send(channel_t *channel, message_t message) {
+    uint32_t flags = irq_save();
+    if (!channel->closed && channel_full(channel)) {
+        channel->stats.send_waits++;
+        do {
+            sleep_on(&channel->senders);
+        } while (!channel->closed && channel_full(channel));
+    }
+    bool sent = put(channel, message);
+    irq_restore(flags);
+    return sent;
+}
+
+bool channel_try_send(channel_t *channel, message_t message) {
+    uint32_t flags = irq_save();
+    bool sent = put(channel, message);
+    irq_restore(flags);
+    return sent;
+}
+
+int channel_receive_batch(channel_t *channel, message_t *messages, int max) {
+    uint32_t flags = irq_save();
+    if (!channel->closed && channel_empty(channel)) {
+        channel->stats.receive_waits++;
+        do {
+            sleep_on(&channel->receivers);
+        } while (!channel->closed && channel_empty(channel));
+    }
+    int count = take(channel, messages, max);
+    irq_restore(flags);
+    return count;
+}
+
+bool channel_receive(channel_t *channel, message_t *message) {
+    return channel_receive_batch(channel, message, 1) == 1;
+}
+
+bool channel_try_receive(channel_t *channel, message_t *message) {
+    uint32_t flags = irq_save();
+    int count = take(channel, message, 1);
+    irq_restore(flags);
+    return count == 1;
+}
+
+void channel_close(channel_t *channel) {
+    uint32_t flags = irq_save();
+    channel->closed = true;
+    wake_up(&channel->senders);
+    wake_up(&channel->receivers);
+    irq_restore(flags);
+}
+
+void *page_buffer_alloc() {
+    return (void *) frame_alloc();
+}
+
+void page_buffer_free(void *buffer) {
+    frame_unref((uint32_t) buffer);
+}
+
+#define BENCH_MESSAGES 20000
+#define BENCH_COPIES 1000
+
+static channel_t bench_channel;
+
+/* Every message is a fresh page carrying its sequence number */
+static void bench_producer(void *arg) {
+    for (uint32_t i = 0; i < BENCH_MESSAGES; i++) {
+        uint32_t *page = page_buffer_alloc();
+        if (page == NULL_POINTER) {
+            break;
+        }
+        page[0] = i;
+        message_t message = {page, PAGE_SIZE};
+        if (!channel_send(&bench_channel, message)) {
+            page_buffer_free(page);
+            break;
+        }
+    }
+    channel_close(&bench_channel);
+}
+
+/* The calling thread is the consumer, taking up to 'batch' messages at a time */
+static void bench_round(char *name, int batch) {
+    channel_init(&bench_channel);
+    if (thread_create("producer", bench_producer, NULL_POINTER, current_thread()->console) == NULL_POINTER) {
+        print_string("No free thread for the producer.\n");
+        return;
+    }
+
+    message_t messages[CHANNEL_CAPACITY];
+    uint32_t received = 0;
+    bool in_order = true;
+    int count;
+    uint64_t start = rdtsc();
+    while ((count = channel_receive_batch(&bench_channel, messages, batch)) > 0) {
+        for (int i = 0; i < count; i++) {
+            in_order &= ((uint32_t *) messages[i].data)[0] == received++;
+            page_buffer_free(messages[i].data);
+        }
+    }
+    uint32_t cycles = cycles_per_op(rdtsc() - start, received);
+
+    print_string(name);
+    print_number(received);
+    print_string(" messages, ");
+    print_number(cycles);
+    print_string(" cycles each, ");
+    print_number(bench_channel.stats.receive_waits);
+    print_string(" consumer waits, ");
+    print_number(bench_channel.stats.send_waits);
+    print_string(" producer waits\n");
+    if (!in_order) {
+        print_string("Messages arrived OUT OF ORDER.\n");
+    }
+}
+
+void run_channel_benchmark() {
+    bench_round("one at a time: ", 1);
+    bench_round("batched: ", CHANNEL_CAPACITY);
+
+    /* What a channel copying its payload would add per message */
+    uint8_t *source = page_buffer_alloc();
+    uint8_t *dest = page_buffer_alloc();
+    if (source != NULL_POINTER && dest != NULL_POINTER) {
+        uint64_t start = rdtsc();
+        for (int i = 0; i < BENCH_COPIES; i++) {
+            memory_copy(source, dest, PAGE_SIZE);
+        }
+        print_number(cycles_per_op(rdtsc() - start, BENCH_COPIES));
+        print_string(" cycles to copy a page instead\n");
+    }
+    if (dest != NULL_POINTER) {
+        page_buffer_free(dest);
+    }
+    if (source != NULL_POINTER) {
+        page_buffer_free(source);
+    }
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "thread.h"
+
+#define CHANNEL_CAPACITY 16 /* messages, a power of two */
+
+/* Only the pointer travels: whoever sends a message gives up the buffer,
+ * the receiver owns it afterwards and has to free it */
+typedef struct {
+    void *data;
+    uint32_t length;
+} message_t;
+
+typedef struct {
+    uint32_t sent;
+    uint32_t received;
+    uint32_t send_waits; /* a sender found the channel full and slept */
+    uint32_t receive_waits; /* a receiver found it empty and slept */
+} channel_stats_t;
+
+/* Bounded queue of messages between kernel threads, and from IRQ handlers
+ * (with the try variants). A zeroed channel is an empty, open one. */
+typedef struct {
+    message_t slots[CHANNEL_CAPACITY];
+    uint32_t head; /* next message to receive, free running */
+    uint32_t tail; /* next free slot, free running */
+    bool closed;
+    wait_queue_t senders; /* waiting for room */
+    wait_queue_t receivers; /* waiting for messages */
+    channel_stats_t stats;
+} channel_t;
+
+void channel_init(channel_t *channel);
+
+/* Sleep while the channel is full. False if it is closed, the message
+ * then still belongs to the caller. */
+bool channel_send(channel_t *channel, message_t message);
+
+/* Never sleeps, false if the channel is full or closed. Safe from IRQ handlers. */
+bool channel_try_send(channel_t *channel, message_t message);
+
+/* Sleep until there is a message. False once the channel is closed and
+ * everything sent before has been received. */
+bool channel_receive(channel_t *channel, message_t *message);
+
+/* Never sleeps, false if there is no message */
+bool channel_try_receive(channel_t *channel, message_t *message);
+
+/* Take up to 'max' messages at once, sleeping until there is at least one.
+ * Returns how many, 0 once the channel is closed and drained. */
+int channel_receive_batch(channel_t *channel, message_t *messages, int max);
+
+/* No more sends; sleeping senders and receivers are woken up */
+void channel_close(channel_t *channel);
+
+/* Page sized buffers for messages. They are whole frames, reachable at
+ * their physical address, so they can be passed on to DMA too. */
+void *page_buffer_alloc();
+void page_buffer_free(void *buffer);
+
+/* Producer thread -> consumer throughput, one at a time and batched */
+void run_channel_benchmark();
@@ -0,0 +1,136 @@
+#include "elf.h"
+#include "mem.h"
+#include "util.h"
+#include "../cpu/paging.h"
+#include "../cpu/syscall.h"
+#include "../drivers/display.h"
+
+typedef struct {
+    program_image_t *image;
+    elf32_program_header_t header;
+} elf_segment_t;
+
+/* One program runs at a time for now */
+static address_space_t process_space;
+static elf_segment_t process_segments[ELF_MAX_SEGMENTS];
+
+static uint32_t image_size(program_image_t *image) {
+    return image->data_end - image->data;
+}
+
+/* populate callback for a PT_LOAD segment */
+static uint32_t populate_elf(vm_region_t *region, uint32_t page, bool *shared) {
+    elf_segment_t *segment = region->data;
+    elf32_program_header_t *header = &segment->header;
+    program_image_t *image = segment->image;
+    uint32_t file_end = header->vaddr + header->filesz;
+
+    /* A page made only of file data maps the cached file page. Segments are
+     * congruent to their file offset modulo the page size, so this is a
+     * whole page of the file. */
+    uint32_t file_offset = (header->offset & PAGE_MASK) + (page - (header->vaddr & PAGE_MASK));
+    uint32_t cache_index = file_offset / PAGE_SIZE;
+    if (page + PAGE_SIZE <= file_end && file_offset + PAGE_SIZE <= image_size(image)
+        && cache_index < ELF_MAX_IMAGE_PAGES) {
+        uint32_t frame = image->page_cache[cache_index];
+        if (frame == 0) {
+            frame = frame_alloc();
+            if (frame == 0) {
+                return 0;
+            }
+            memory_copy(image->data + file_offset, (uint8_t *) frame, PAGE_SIZE);
+            image->page_cache[cache_index] = frame; /* the cache keeps this reference */
+        }
+        frame_ref(frame);
+        *shared = true;
+        return frame;
+    }
+
+    /* Page with the end of the file data and/or .bss: private, zero filled */
+    uint32_t frame = populate_zero(region, page, shared);
+    if (frame == 0) {
+        return 0;
+    }
+    uint32_t from = page < header->vaddr ? header->vaddr : page;
+    uint32_t to = page + PAGE_SIZE < file_end ? page + PAGE_SIZE : file_end;
+    if (from < to) {
+        memory_copy(image->data + header->offset + (from - header->vaddr),
+                    (uint8_t *) frame + (from - page), to - from);
+    }
+    return frame;
+}
+
+static bool elf_valid(program_image_t *image, elf32_header_t *header) {
+    return image_size(image) >= sizeof(elf32_header_t)
+           && *(uint32_t *) header->ident == ELF_MAGIC
+           && header->ident[4] == ELF_CLASS_32
+           && header->type == ELF_TYPE_EXEC
+           && header->machine == ELF_MACHINE_386
+           && header->phentsize >= sizeof(elf32_program_header_t)
+           && header->phoff + header->phnum * header->phentsize <= image_size(image);
+}
+
+/* Set up a region for every loadable segment, without touching its pages */
+static bool map_segments(program_image_t *image, elf32_header_t *header) {
+    int segments = 0;
+    for (int i = 0; i < header->phnum; i++) {
+        elf32_program_header_t *program_header =
+                (elf32_program_header_t *) (image->data + header->phoff + i * header->phentsize);
+        if (program_header->type != ELF_PT_LOAD) {
+            continue;
+        }
+        if (segments == ELF_MAX_SEGMENTS
+            || program_header->offset + program_header->filesz > image_size(image)
+            || program_header->filesz > program_header->memsz) {
+            return false;
+        }
+
+        elf_segment_t *segment = &process_segments[segments++];
+        segment->image = image;
+        segment->header = *program_header;
+
+        vm_region_t *region = address_space_add_region(
+                &process_space, program_header->vaddr, program_header->vaddr + program_header->memsz,
+                (program_header->flags & ELF_PF_W) ? VM_WRITE : 0);
+        if (region == NULL_POINTER) {
+            return false;
+        }
+        region->populate = populate_elf;
+        region->data = segment;
+    }
+    return address_space_add_region(&process_space, USER_STACK_TOP - USER_STACK_SIZE, USER_STACK_TOP, VM_WRITE)
+           != NULL_POINTER;
+}
+
+int elf_run(program_image_t *image) {
+    elf32_header_t *header = (elf32_header_t *) image->data;
+    if (!elf_valid(image, header)) {
+        print_string("Not an i386 ELF executable.\n");
+        return -1;
+    }
+    if (!address_space_init(&process_space)) {
+        print_string("Out of memory.\n");
+        return -1;
+    }
+    if (!map_segments(image, header)) {
+        print_string("Unsupported program layout.\n");
+        address_space_destroy(&process_space);
+        return -1;
+    }
+
+    switch_address_space(&process_space);
+    int exit_code = enter_user_mode(header->entry, USER_STACK_TOP);
+    switch_address_space(NULL_POINTER);
+
+    print_string("pages mapped: ");
+
+    print_number(process_space.pages_mapped);
+    print_string(", page faults: ");
+    print_number(process_space.page_faults);
+    print_string(", copied on write: ");
+    print_number(process_space.cow_copies);
+    print_nl();
+
+    address_space_destroy(&process_space);
+    return exit_code;
+}
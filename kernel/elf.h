@@ -0,0 +1,62 @@
+#pragma once
+
+#include <stdint.h>
+#include "../cpu/paging.h"
+
+#define ELF_MAGIC 0x464C457F /* "\x7F" "ELF" read as a little endian word */
+#define ELF_CLASS_32 1
+#define ELF_TYPE_EXEC 2
+#define ELF_MACHINE_386 3
+#define ELF_PT_LOAD 1
+#define ELF_PF_W 0x2
+
+typedef struct {
+    uint8_t ident[16];
+    uint16_t type;
+    uint16_t machine;
+    uint32_t version;
+    uint32_t entry;
+    uint32_t phoff; /* file offset of the program headers */
+    uint32_t shoff;
+    uint32_t flags;
+    uint16_t ehsize;
+    uint16_t phentsize;
+    uint16_t phnum;
+    uint16_t shentsize;
+    uint16_t shnum;
+    uint16_t shstrndx;
+} __attribute__((packed)) elf32_header_t;
+
+typedef struct {
+    uint32_t type;
+    uint32_t offset;
+    uint32_t vaddr;
+    uint32_t paddr;
+    uint32_t filesz;
+    uint32_t memsz;
+    uint32_t flags;
+    uint32_t align;
+} __attribute__((packed)) elf32_program_header_t;
+
+#define ELF_MAX_SEGMENTS 4
+#define ELF_MAX_IMAGE_PAGES 16
+
+#define USER_STACK_TOP USER_SPACE_END
+#define USER_STACK_SIZE (64 * 1024)
+
+/* An executable in memory. The frames holding its file pages are cached and
+ * shared by every instance; they stay cached once loaded. */
+typedef struct {
+    char *name;
+    uint8_t *data;
+    uint8_t *data_end;
+    uint32_t page_cache[ELF_MAX_IMAGE_PAGES]; /* frame per file page, 0 until first touched */
+} program_image_t;
+
+/* Map the executable into a fresh address space and run it in ring 3.
+ * Nothing is copied up front, pages come in as the program touches them.
+ * Returns the exit code, or -1 if it couldn't be started or crashed. */
+int elf_run(program_image_t *image);
+
+/* The programs built into the kernel image, see programs.c */
+program_image_t *find_program(char *name);
@@ -1,11 +1,24 @@
+#include "../cpu/gdt.h"
 #include "../cpu/idt.h"
 #include "../cpu/isr.h"
+#include "../cpu/fpu.h"
+#include "../cpu/syscall.h"
 #include "../cpu/timer.h"
+#include "../cpu/paging.h"
+#include "../cpu/idle.h"
 #include "../drivers/display.h"
 #include "../drivers/keyboard.h"
+#include "../drivers/ata.h"
+#include "../drivers/pci.h"
+#include "../drivers/virtio_blk.h"
+#include "../drivers/serial.h"
 
 #include "util.h"
 #include "mem.h"
+#include "boottime.h"
+#include "thread.h"
+#include "../apps/shell.h"
+#include "bench.h"
 
 void* alloc(int n) {
     int *ptr = (int *) mem_alloc(n * sizeof(int));
@@ -29,15 +42,50 @@ void* alloc(int n) {
 
 void main() {
 
+    boot_log_stamp(BOOT_CLEAR_SCREEN_BEGIN);
     clear_screen();
+    boot_log_stamp(BOOT_CLEAR_SCREEN_END);
+
+    init_serial();
+
+    print_string("Installing GDT with user segments and TSS.\n");
+    gdt_install();
+
     print_string("Installing interrupt service routines (ISRs).\n");
+    boot_log_stamp(BOOT_ISR_INSTALL_BEGIN);
     isr_install();
+    boot_log_stamp(BOOT_ISR_INSTALL_END);
+
+    print_string("Enabling SSE with lazy FPU context switching.\n");
+    init_fpu();
+
+    print_string("Enabling system calls (int 0x80, sysenter).\n");
+    init_syscalls();
+
+    print_string("Enabling paging.\n");
+    init_paging();
+    init_dynamic_mem();
+
+    init_threads();
 
     print_string("Enabling external interrupts.\n");
     asm volatile("sti");
 
     print_string("Initializing keyboard (IRQ 1).\n");
+    boot_log_stamp(BOOT_KEYBOARD_BEGIN);
     init_keyboard();
+    boot_log_stamp(BOOT_KEYBOARD_END);
+
+    print_string("Initializing timer (IRQ 0).\n");
+    init_timer(TIMER_FREQUENCY);
+    init_idle();
+
+    print_string("Probing ATA disk (IRQ 14).\n");
+    init_ata();
+
+    print_string("Scanning PCI for virtio disks.\n");
+    init_pci();
+    init_virtio_blk();
 
     clear_screen();
 
@@ -58,4 +106,19 @@ void main() {
     print_nl();
 
     print_string("> ");
+
+    /* The other consoles only get a prompt */
+    for (int console = 1; console < NUM_CONSOLES; console++) {
+        set_output_console(console);
+        clear_screen();
+        print_string("> ");
+    }
+    set_output_console(0);
+    start_shells();
+    boot_log_stamp(BOOT_SHELL_READY);
+
+    if (bench_requested()) {
+        bool ok = run_benchmarks();
+        qemu_exit(ok ? QEMU_EXIT_SUCCESS : QEMU_EXIT_FAILURE);
+    }
 }
\ No newline at end of file
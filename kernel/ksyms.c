@@ -0,0 +1,75 @@
+#include "ksyms.h"
+#include "mem.h"
+#include "util.h"
+#include "../cpu/paging.h"
+#include "../drivers/display.h"
+
+#define BACKTRACE_MAX_DEPTH 16
+
+extern uint8_t _etext[]; /* linker.ld */
+
+const char *ksym_lookup(uint32_t address, uint32_t *offset) {
+    if (address >= (uint32_t) _etext) {
+        return NULL_POINTER;
+    }
+    /* Last symbol at or below 'address' */
+    int low = 0;
+    int high = (int) ksymtab_count - 1;
+    int found = -1;
+    while (low <= high) {
+        int middle = (low + high) / 2;
+        if (ksymtab[middle].address <= address) {
+            found = middle;
+            low = middle + 1;
+        } else {
+            high = middle - 1;
+        }
+    }
+    if (found < 0) {
+        return NULL_POINTER;
+    }
+    *offset = address - ksymtab[found].address;
+    return &ksym_names[ksymtab[found].name];
+}
+
+void print_symbol(uint32_t address) {
+    char ascii[16];
+    uint32_t offset;
+    const char *name = ksym_lookup(address, &offset);
+    if (name != NULL_POINTER) {
+        print_string((char *) name);
+        print_string("+");
+        int_to_string(offset, ascii);
+        print_string(ascii);
+        print_string(" ");
+    }
+    hex_to_string(address, ascii);
+    print_string("(");
+    print_string(ascii);
+    print_string(")");
+}
+
+/* Only follow frame pointers into memory that is always mapped */
+static bool frame_valid(uint32_t ebp) {
+    return ebp != 0 && (ebp & 3) == 0 && ebp < IDENTITY_MAP_SIZE - 8;
+}
+
+void print_backtrace(uint32_t ebp) {
+    for (int depth = 0; depth < BACKTRACE_MAX_DEPTH && frame_valid(ebp); depth++) {
+        uint32_t *frame = (uint32_t *) ebp;
+        uint32_t return_address = frame[1];
+        if (return_address == 0) {
+            break;
+        }
+        print_string("  ");
+        /* -1: the call instruction, not whatever follows it */
+        print_symbol(return_address - 1);
+        print_nl();
+
+        /* Frames only ever get older going up the stack */
+        if (frame[0] <= ebp) {
+            break;
+        }
+        ebp = frame[0];
+    }
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <stdint.h>
+
+/* Kernel symbol table, generated from kernel.elf by tools/ksymtab.sh and
+ * linked into a second build of the kernel (see the makefile) */
+typedef struct {
+    uint32_t address;
+    uint32_t name; /* offset into ksym_names */
+} ksym_t;
+
+extern const ksym_t ksymtab[]; /* sorted by address */
+extern const uint32_t ksymtab_count;
+extern const char ksym_names[];
+
+/* Name of the function containing 'address' and the offset into it,
+ * NULL if the address is below every symbol or past the code */
+const char *ksym_lookup(uint32_t address, uint32_t *offset);
+
+/* "function+offset (0x...)" */
+void print_symbol(uint32_t address);
+
+/* Walk the frame pointer chain starting at 'ebp', one caller per line.
+ * Stops at the 0 kernel_entry and new threads start with. */
+void print_backtrace(uint32_t ebp);
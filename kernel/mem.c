@@ -3,6 +3,7 @@
 #include "mem.h"
 #include "../drivers/display.h"
 #include "util.h"
+#include "../cpu/paging.h"
 
 // http://www.sunshine2k.de/articles/coding/cmemalloc/cmemory.html#ch33
 
@@ -18,7 +19,9 @@ void memory_copy(uint8_t *source, uint8_t *dest, uint32_t nbytes) {
  * and thus also licensed under MIT license I guess?
  * For further details, see http://www.sunshine2k.de/license.html.
  */
-#define DYNAMIC_MEM_TOTAL_SIZE 4*1024
+/* The heap lives in its own virtual range, pages are backed by frames only
+ * once touched (see paging.c), so its size costs nothing up front */
+#define DYNAMIC_MEM_TOTAL_SIZE KERNEL_HEAP_SIZE
 #define DYNAMIC_MEM_NODE_SIZE sizeof(dynamic_mem_node_t)
 
 typedef struct dynamic_mem_node {
@@ -28,12 +31,13 @@ typedef struct dynamic_mem_node {
     struct dynamic_mem_node *prev;
 } dynamic_mem_node_t;
 
-static uint8_t dynamic_mem_area[DYNAMIC_MEM_TOTAL_SIZE];
+static uint8_t *const dynamic_mem_area = (uint8_t *) KERNEL_HEAP_START;
 static dynamic_mem_node_t *dynamic_mem_start;
 
 void init_dynamic_mem() {
     dynamic_mem_start = (dynamic_mem_node_t *) dynamic_mem_area;
     dynamic_mem_start->size = DYNAMIC_MEM_TOTAL_SIZE - DYNAMIC_MEM_NODE_SIZE;
+    dynamic_mem_start->used = false;
     dynamic_mem_start->next = NULL_POINTER;
     dynamic_mem_start->prev = NULL_POINTER;
 }
@@ -66,6 +70,12 @@ void print_dynamic_mem() {
         current = current->next;
     }
     print_string("]\n");
+
+    char resident_string[16];
+    int_to_string(heap_pages_mapped() * PAGE_SIZE / 1024, resident_string);
+    print_string("resident: ");
+    print_string(resident_string);
+    print_string(" KiB\n");
 }
 
 void *find_best_mem_block(dynamic_mem_node_t *dynamic_mem, size_t size) {
@@ -150,7 +160,9 @@ void *merge_current_node_into_previous(dynamic_mem_node_t *current_mem_node) {
         if (current_mem_node->next != NULL_POINTER) {
             current_mem_node->next->prev = prev_mem_node;
         }
+        return prev_mem_node;
     }
+    return current_mem_node;
 }
 
 void mem_free(void *p) {
@@ -172,5 +184,9 @@ void mem_free(void *p) {
 
     // merge unused blocks
     current_mem_node = merge_next_node_into_current(current_mem_node);
-    merge_current_node_into_previous(current_mem_node);
+    current_mem_node = merge_current_node_into_previous(current_mem_node);
+
+    // hand whole pages of the free block back, they fault in again when reused
+    uint8_t *free_start = (uint8_t *) current_mem_node + DYNAMIC_MEM_NODE_SIZE;
+    heap_release((uint32_t) free_start, (uint32_t) (free_start + current_mem_node->size));
 }
\ No newline at end of file
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <stdint.h>
+
+/* Bits in multiboot_info_t.flags telling which fields are valid */
+#define MULTIBOOT_INFO_MEMORY  (1 << 0)
+#define MULTIBOOT_INFO_CMDLINE (1 << 2)
+
+/* Boot information passed by a Multiboot loader (only the fields we read) */
+typedef struct {
+    uint32_t flags;
+    uint32_t mem_lower; /* KiB of memory below 1 MiB */
+    uint32_t mem_upper; /* KiB of memory above 1 MiB */
+    uint32_t boot_device;
+    uint32_t cmdline; /* physical address of a zero-terminated string */
+} __attribute__((packed)) multiboot_info_t;
+
+/* Set by kernel_entry.asm; NULL when booted from the MBR */
+extern multiboot_info_t *multiboot_info;
@@ -0,0 +1,19 @@
+#include "elf.h"
+#include "mem.h"
+#include "util.h"
+
+/* Executables from user/, linked in as raw ELF files by the makefile */
+extern uint8_t _binary_hello_elf_start[], _binary_hello_elf_end[];
+
+static program_image_t programs[] = {
+        {"HELLO", _binary_hello_elf_start, _binary_hello_elf_end},
+};
+
+program_image_t *find_program(char *name) {
+    for (int i = 0; i < sizeof(programs) / sizeof(programs[0]); i++) {
+        if (compare_string(programs[i].name, name) == 0) {
+            return &programs[i];
+        }
+    }
+    return NULL_POINTER;
+}
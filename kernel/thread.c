@@ -0,0 +1,156 @@
+#include "thread.h"
+#include "mem.h"
+#include "../drivers/display.h"
+#include "../cpu/percpu.h"
+
+/* Implemented in switch.asm */
+void switch_context(uint32_t *old_esp, uint32_t new_esp);
+
+static thread_t threads[MAX_THREADS];
+static uint8_t thread_stacks[MAX_THREADS][THREAD_STACK_SIZE] __attribute__((aligned(16)));
+
+/* Runs on the boot stack and never blocks, so there is always something to switch to */
+static thread_t idle_thread = {.state = THREAD_RUNNABLE, .name = "idle", .console = 0};
+static wait_queue_t run_queue;
+
+void wait_queue_init(wait_queue_t *queue) {
+    queue->head = NULL_POINTER;
+    queue->tail = NULL_POINTER;
+}
+
+static void enqueue(wait_queue_t *queue, thread_t *thread) {
+    thread->next = NULL_POINTER;
+    if (queue->tail == NULL_POINTER) {
+        queue->head = thread;
+    } else {
+        queue->tail->next = thread;
+    }
+    queue->tail = thread;
+}
+
+static thread_t *dequeue(wait_queue_t *queue) {
+    thread_t *thread = queue->head;
+    if (thread != NULL_POINTER) {
+        queue->head = thread->next;
+        if (queue->head == NULL_POINTER) {
+            queue->tail = NULL_POINTER;
+        }
+    }
+    return thread;
+}
+
+void init_threads() {
+    wait_queue_init(&run_queue);
+    this_cpu_write(current_thread, &idle_thread);
+}
+
+thread_t *current_thread() {
+    return this_cpu_read(current_thread);
+}
+
+bool threads_runnable() {
+    return run_queue.head != NULL_POINTER;
+}
+
+void schedule() {
+    thread_t *previous = current_thread();
+    thread_t *next = dequeue(&run_queue);
+    if (next == NULL_POINTER) {
+        next = &idle_thread;
+    }
+    if (next == previous) {
+        return;
+    }
+
+    this_cpu_write(current_thread, next);
+    this_cpu_inc(context_switches);
+    set_output_console(next->console);
+    fpu_switch_to(&next->fpu);
+    switch_context(&previous->esp, next->esp);
+    /* back here once 'previous' is scheduled again */
+}
+
+/* First code of every thread; schedule() switched here with interrupts off */
+static void thread_start() {
+    asm volatile("sti");
+    thread_t *current = current_thread();
+    current->entry(current->arg);
+    thread_exit();
+}
+
+thread_t *thread_create(char *name, void (*entry)(void *arg), void *arg, int console) {
+    uint32_t flags = irq_save();
+    thread_t *thread = NULL_POINTER;
+    for (int i = 0; i < MAX_THREADS; i++) {
+        if (threads[i].state == THREAD_UNUSED || threads[i].state == THREAD_DEAD) {
+            thread = &threads[i];
+            break;
+        }
+    }
+    if (thread == NULL_POINTER) {
+        irq_restore(flags);
+        return NULL_POINTER;
+    }
+
+    thread->name = name;
+    thread->console = console;
+    thread->entry = entry;
+    thread->arg = arg;
+    thread->fpu.initialized = false;
+
+    /* What switch_context pops: edi, esi, ebx, ebp, then it returns into
+     * thread_start, which itself never returns */
+    uint32_t *stack = (uint32_t *) (thread_stacks[thread - threads] + THREAD_STACK_SIZE);
+    *--stack = 0;
+    *--stack = (uint32_t) thread_start;
+    for (int i = 0; i < 4; i++) {
+        *--stack = 0;
+    }
+    thread->esp = (uint32_t) stack;
+
+    thread->state = THREAD_RUNNABLE;
+    enqueue(&run_queue, thread);
+    irq_restore(flags);
+    return thread;
+}
+
+void thread_exit() {
+    asm volatile("cli");
+    /* The stack stays in use until we've switched away, and nothing can
+     * take the slot before that with interrupts off */
+    current_thread()->state = THREAD_DEAD;
+    schedule();
+}
+
+void thread_yield() {
+    uint32_t flags = irq_save();
+    thread_t *current = current_thread();
+    if (current != &idle_thread) {
+        enqueue(&run_queue, current);
+    }
+    schedule();
+    irq_restore(flags);
+}
+
+void sleep_on(wait_queue_t *queue) {
+    thread_t *current = current_thread();
+    if (current == &idle_thread) {
+        /* Nothing else may run on the boot stack, just wait for the
+         * interrupt; the caller checks its condition again */
+        asm volatile("sti; hlt; cli" : : : "memory");
+        return;
+    }
+    current->state = THREAD_BLOCKED;
+    enqueue(queue, current);
+    schedule();
+}
+
+void wake_up(wait_queue_t *queue) {
+    uint32_t flags = irq_save();
+    thread_t *thread;
+    while ((thread = dequeue(queue)) != NULL_POINTER) {
+        thread->state = THREAD_RUNNABLE;
+        enqueue(&run_queue, thread);
+    }
+    irq_restore(flags);
+}
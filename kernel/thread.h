@@ -0,0 +1,72 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "../cpu/fpu.h"
+#include "../cpu/isr.h"
+
+#define MAX_THREADS 8
+#define THREAD_STACK_SIZE 8192
+
+typedef enum {
+    THREAD_UNUSED,
+    THREAD_RUNNABLE, /* running, or waiting on the run queue */
+    THREAD_BLOCKED,
+    THREAD_DEAD,
+} thread_state_t;
+
+/* Kernel threads are cooperative: one runs until it blocks, yields or
+ * exits. Interrupt handlers only ever wake threads up. */
+typedef struct thread {
+    uint32_t esp; /* saved by switch_context while not running */
+    thread_state_t state;
+    char *name;
+    int console; /* where its print_string output goes */
+    void (*entry)(void *arg);
+    void *arg;
+    struct thread *next; /* on the run queue or a wait queue */
+    fpu_context_t fpu;
+} thread_t;
+
+typedef struct {
+    thread_t *head;
+    thread_t *tail;
+} wait_queue_t;
+
+/* The boot context becomes the idle thread */
+void init_threads();
+
+thread_t *thread_create(char *name, void (*entry)(void *arg), void *arg, int console);
+
+void thread_exit();
+
+/* Let the other runnable threads have a turn */
+void thread_yield();
+
+thread_t *current_thread();
+
+bool threads_runnable();
+
+/* Switch to the next runnable thread, or to the idle thread if there is
+ * none. Interrupts must be disabled. */
+void schedule();
+
+void wait_queue_init(wait_queue_t *queue);
+
+/* Block the current thread on 'queue' until woken up. Interrupts must be
+ * disabled; they still are on return. */
+void sleep_on(wait_queue_t *queue);
+
+/* Make every thread waiting on 'queue' runnable. Safe from IRQ handlers. */
+void wake_up(wait_queue_t *queue);
+
+/* Sleep until 'condition' holds. It is checked with interrupts disabled,
+ * so a wake_up from an IRQ handler can't be missed. */
+#define wait_event(queue, condition) \
+    do { \
+        uint32_t wait_flags = irq_save(); \
+        while (!(condition)) { \
+            sleep_on(queue); \
+        } \
+        irq_restore(wait_flags); \
+    } while (0)
@@ -46,6 +46,35 @@ void int_to_string(int n, char str[]) {
     reverse(str);
 }
 
+/* Same as int_to_string for 64-bit values. Divides with 'div', which takes
+ * a 64-bit dividend, so we don't need libgcc's 64-bit division. */
+void uint64_to_string(uint64_t n, char str[]) {
+    int i = 0;
+    do {
+        uint32_t high = (uint32_t) (n >> 32);
+        uint32_t low = (uint32_t) n;
+        uint32_t remainder;
+        uint32_t quotient_high = high / 10;
+        // (high % 10) < 10, so the 64/32 division below can't overflow
+        asm("divl %4" : "=a" (low), "=d" (remainder) : "a" (low), "d" (high % 10), "r" (10));
+        n = ((uint64_t) quotient_high << 32) | low;
+        str[i++] = remainder + '0';
+    } while (n > 0);
+    str[i] = '\0';
+
+    reverse(str);
+}
+
+void hex_to_string(uint32_t n, char str[]) {
+    str[0] = '0';
+    str[1] = 'x';
+    for (int i = 0; i < 8; i++) {
+        uint8_t digit = (n >> (28 - 4 * i)) & 0xF;
+        str[2 + i] = digit < 10 ? '0' + digit : 'A' + digit - 10;
+    }
+    str[10] = '\0';
+}
+
 /* K&R
  * Returns <0 if s1<s2, 0 if s1==s2, >0 if s1>s2 */
 int compare_string(char s1[], char s2[]) {
@@ -54,4 +83,46 @@ int compare_string(char s1[], char s2[]) {
         if (s1[i] == '\0') return 0;
     }
     return s1[i] - s2[i];
-}
\ No newline at end of file
+}
+/* GCC expects a freestanding environment to provide these four and may emit
+ * calls to them on its own (struct copies, large initializers), so they must
+ * exist even though kernel code uses memory_copy. 'used' keeps LTO from
+ * dropping them before those calls are generated. */
+__attribute__((used)) void *memcpy(void *dest, const void *src, uint32_t n) {
+    uint8_t *d = dest;
+    const uint8_t *s = src;
+    for (uint32_t i = 0; i < n; i++) d[i] = s[i];
+    return dest;
+}
+
+__attribute__((used)) void *memmove(void *dest, const void *src, uint32_t n) {
+    uint8_t *d = dest;
+    const uint8_t *s = src;
+    if (d < s) {
+        for (uint32_t i = 0; i < n; i++) d[i] = s[i];
+    } else {
+        for (uint32_t i = n; i > 0; i--) d[i - 1] = s[i - 1];
+    }
+    return dest;
+}
+
+__attribute__((used)) void *memset(void *dest, int c, uint32_t n) {
+    uint8_t *d = dest;
+    for (uint32_t i = 0; i < n; i++) d[i] = (uint8_t) c;
+    return dest;
+}
+
+__attribute__((used)) int memcmp(const void *a, const void *b, uint32_t n) {
+    const uint8_t *x = a, *y = b;
+    for (uint32_t i = 0; i < n; i++) {
+        if (x[i] != y[i]) return x[i] - y[i];
+    }
+    return 0;
+}
+
+bool string_starts_with(char s[], char prefix[]) {
+    for (int i = 0; prefix[i] != '\0'; i++) {
+        if (s[i] != prefix[i]) return false;
+    }
+    return true;
+}
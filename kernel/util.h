@@ -8,6 +8,8 @@
 
 int compare_string(char s1[], char s2[]);
 
+bool string_starts_with(char s[], char prefix[]);
+
 void memory_copy(uint8_t *source, uint8_t *dest, uint32_t nbytes);
 
 int string_length(char s[]);
@@ -16,4 +18,9 @@ void reverse(char s[]);
 
 bool backspace(char buffer[]);
 
-void int_to_string(int n, char str[]);
\ No newline at end of file
+void int_to_string(int n, char str[]);
+
+void uint64_to_string(uint64_t n, char str[]);
+
+/* "0x" followed by 8 digits, 'str' needs room for 11 chars */
+void hex_to_string(uint32_t n, char str[]);
\ No newline at end of file
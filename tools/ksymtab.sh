@@ -0,0 +1,42 @@
+#!/bin/sh
+# Turns `nm -n kernel.elf` (on stdin) into the C source of the kernel symbol
+# table, see kernel/ksyms.h. Only code symbols below _etext are kept, already
+# sorted by address. Everything, names included, goes into the .ksymtab section, which
+# linker.ld places after the code so adding the table moves no function.
+awk '
+BEGIN {
+    count = 0
+    done = 0
+}
+$3 == "_etext" {
+    done = 1
+}
+!done && $2 ~ /^[tTwW]$/ && NF == 3 {
+    address[count] = $1
+    name[count] = $3
+    count++
+}
+END {
+    print "/* Generated by tools/ksymtab.sh, do not edit */"
+    print "#include \"kernel/ksyms.h\""
+    print ""
+    print "#define KSYMTAB __attribute__((section(\".ksymtab\")))"
+    print ""
+    printf "KSYMTAB const char ksym_names[] = \""
+    offset = 0
+    for (i = 0; i < count; i++) {
+        printf "%s\\0", name[i]
+        name_offset[i] = offset
+        offset += length(name[i]) + 1
+    }
+    print "\";"
+    print "KSYMTAB const uint32_t ksymtab_count = " count ";"
+    print "KSYMTAB const ksym_t ksymtab[] = {"
+    for (i = 0; i < count; i++) {
+        printf "        {0x%s, %d},\n", address[i], name_offset[i]
+    }
+    if (count == 0) {
+        print "        {0, 0},"
+    }
+    print "};"
+}'
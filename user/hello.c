@@ -0,0 +1,10 @@
+#include "user.h"
+
+/* Writable data: the first write gives this program its own copy of the page */
+static char greeting[] = "hello from ring 3!\n";
+
+void _start() {
+    greeting[0] = 'H';
+    write(greeting);
+    exit(0);
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+/* Runtime for programs in user/. They are linked on their own and loaded by
+ * kernel/elf.c, so all they can do is make system calls. */
+#include <stdint.h>
+#include "../cpu/syscall.h"
+
+static inline uint32_t syscall(uint32_t number, uint32_t arg1, uint32_t arg2, uint32_t arg3) {
+    uint32_t result;
+    asm volatile("int $0x80" : "=a" (result) : "a" (number), "b" (arg1), "S" (arg2), "D" (arg3) : "memory");
+    return result;
+}
+
+static inline void exit(int code) {
+    syscall(SYS_EXIT, code, 0, 0);
+}
+
+static inline void write(char *string) {
+    syscall(SYS_WRITE, (uint32_t) string, 0, 0);
+}
+
+static inline uint32_t get_tick() {
+    return syscall(SYS_GET_TICK, 0, 0, 0);
+}